@@ -0,0 +1,71 @@
+#include "BlockTable.h"
+
+void BlockTable::reserve(size_t maxEntries) {
+    size_t capacity = 16;
+    while (capacity < maxEntries * 2) capacity <<= 1;
+    if (capacity <= m_capacity) return;
+
+    std::unique_ptr<Entry[]> old = std::move(m_entries);
+    size_t oldCapacity = m_capacity;
+    m_entries.reset(new Entry[capacity]);
+    m_capacity = capacity;
+    m_mask = capacity - 1;
+    m_shift = 64 - __builtin_ctzll(capacity);
+    m_size = 0;
+    for (size_t i = 0; i < capacity; i++) m_entries[i].key = EMPTY;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].key != EMPTY) insert(old[i].key, old[i].slot);
+    }
+}
+
+size_t BlockTable::find(size_t key) const {
+    if (m_size == 0) return NOT_FOUND;
+    for (size_t i = home(key);; i = (i + 1) & m_mask) { // 负载因子不超过1/2，必然遇到空表项
+        const Entry& entry = m_entries[i];
+        if (entry.key == key) return entry.slot;
+        if (entry.key == EMPTY) return NOT_FOUND;
+    }
+}
+
+void BlockTable::insert(size_t key, size_t slot) {
+    if ((m_size + 1) * 2 > m_capacity) reserve(m_size + 1);
+    for (size_t i = home(key);; i = (i + 1) & m_mask) {
+        Entry& entry = m_entries[i];
+        if (entry.key == key) {
+            entry.slot = slot;
+            return;
+        }
+        if (entry.key == EMPTY) {
+            entry.key = key;
+            entry.slot = slot;
+            m_size++;
+            return;
+        }
+    }
+}
+
+bool BlockTable::erase(size_t key) {
+    if (m_size == 0) return false;
+    for (size_t i = home(key);; i = (i + 1) & m_mask) {
+        if (m_entries[i].key == key) {
+            eraseAt(i);
+            return true;
+        }
+        if (m_entries[i].key == EMPTY) return false;
+    }
+}
+
+void BlockTable::eraseAt(size_t index) {
+    // 向后扫描同一连续段，初始位置不在(hole, j]内的表项可以前移填补空位，查找时不会越过它
+    size_t hole = index;
+    for (size_t j = (index + 1) & m_mask; m_entries[j].key != EMPTY; j = (j + 1) & m_mask) {
+        size_t h = home(m_entries[j].key);
+        bool reachable = hole <= j ? (hole < h && h <= j) : (hole < h || h <= j);
+        if (!reachable) {
+            m_entries[hole] = m_entries[j];
+            hole = j;
+        }
+    }
+    m_entries[hole].key = EMPTY;
+    m_size--;
+}
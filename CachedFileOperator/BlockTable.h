@@ -0,0 +1,66 @@
+#ifndef BlockTable_H
+#define BlockTable_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+块表：块键 -> 分片内槽号的开放寻址哈希表，取代std::unordered_map。
+所有表项存放在一个连续数组中，线性探测，删除时把后续表项前移（不留墓碑），查找只访问相邻的缓存行。
+按最多元素数reserve()之后，查找、插入、删除都不分配内存。
+*/
+class BlockTable {
+public:
+    static const size_t NOT_FOUND = SIZE_MAX;
+
+    BlockTable() = default;
+    void reserve(size_t maxEntries); // 按最多元素数分配（负载因子不超过1/2），已有的表项重新插入
+    size_t find(size_t key) const; // 返回槽号，不存在时返回NOT_FOUND
+    bool contains(size_t key) const { return find(key) != NOT_FOUND; }
+    void insert(size_t key, size_t slot); // 插入或覆盖；超过reserve()的大小时自动扩大
+    bool erase(size_t key); // 若存在则删除并返回true
+    size_t size() const { return m_size; }
+
+    template <typename F>
+    void forEach(F f) const { // 对每个表项调用f(key, slot)，期间不能修改表
+        for (size_t i = 0; i < m_capacity; i++) {
+            if (m_entries[i].key != EMPTY) f(m_entries[i].key, m_entries[i].slot);
+        }
+    }
+
+    template <typename P>
+    size_t eraseIf(P pred) { // 删除所有满足pred(key, slot)的表项，返回删除的个数
+        size_t erased = 0;
+        size_t i = 0;
+        while (i < m_capacity) {
+            // 前移可能把未检查的表项移到当前位置，删除后原地再检查一次
+            if (m_entries[i].key != EMPTY && pred(m_entries[i].key, m_entries[i].slot)) {
+                eraseAt(i);
+                erased++;
+            } else {
+                i++;
+            }
+        }
+        return erased;
+    }
+
+private:
+    static const size_t EMPTY = SIZE_MAX; // 空表项的键，块键的高位是句柄，不会取到该值
+    typedef struct Entry{
+        size_t key;
+        size_t slot;
+    }Entry;
+
+    size_t home(size_t key) const { // 键的初始位置：乘法哈希取高位
+        return (key * 0x9E3779B97F4A7C15ULL) >> m_shift;
+    }
+    void eraseAt(size_t index); // 删除index处的表项，并把同一探测序列中后面的表项前移
+
+    std::unique_ptr<Entry[]> m_entries;
+    size_t m_capacity = 0; // 2的幂
+    size_t m_mask = 0;
+    unsigned m_shift = 64;
+    size_t m_size = 0;
+};
+
+#endif // BlockTable_H
@@ -0,0 +1,170 @@
+#include "CacheStatistics.h"
+#include <sstream>
+#include <stdexcept>
+
+const size_t LatencyHistogram::BUCKETS;
+const size_t CacheStatistics::STRIPES;
+
+double LatencyHistogram::percentile(double p) const {
+    if (count == 0) return 0;
+    double rank = p * count;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (buckets[i] == 0) continue;
+        if (seen + buckets[i] >= rank) {
+            double low = i == 0 ? 0 : static_cast<double>(1ULL << (i - 1));
+            double high = i == 0 ? 0 : static_cast<double>(1ULL << i);
+            return low + (high - low) * (rank - seen) / buckets[i];
+        }
+        seen += buckets[i];
+    }
+    return static_cast<double>(1ULL << (BUCKETS - 1));
+}
+
+double LatencyHistogram::mean() const {
+    return count == 0 ? 0 : static_cast<double>(totalNs) / count;
+}
+
+double CacheStats::hitRatio() const {
+    return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+}
+
+double CacheStats::compressionRatio() const {
+    return tierBytesOut == 0 ? 0 : static_cast<double>(tierBytesIn) / tierBytesOut;
+}
+
+static void latencyToJson(std::ostringstream& out, const char* name, const LatencyHistogram& histogram) {
+    out << ",\"" << name << "\":{\"count\":" << histogram.count << ",\"mean_ns\":" << histogram.mean()
+        << ",\"p50_ns\":" << histogram.percentile(0.5) << ",\"p99_ns\":" << histogram.percentile(0.99)
+        << ",\"p999_ns\":" << histogram.percentile(0.999) << "}";
+}
+
+std::string statsToJson(const CacheStats& stats) {
+    std::ostringstream out;
+    out << "{\"hits\":" << stats.hits << ",\"misses\":" << stats.misses << ",\"hit_ratio\":" << stats.hitRatio()
+        << ",\"evictions\":" << stats.evictions << ",\"blocks_written_back\":" << stats.blocksWrittenBack
+        << ",\"bytes_written_back\":" << stats.bytesWrittenBack << ",\"bytes_skipped\":" << stats.bytesSkipped
+        << ",\"bytes_read\":" << stats.bytesRead << ",\"read_calls\":" << stats.readCalls << ",\"write_calls\":" << stats.writeCalls
+        << ",\"readahead_blocks\":" << stats.readaheadBlocks << ",\"readahead_hits\":" << stats.readaheadHits
+        << ",\"readahead_wasted\":" << stats.readaheadWasted
+        << ",\"journal_bytes\":" << stats.journalBytes << ",\"journal_syncs\":" << stats.journalSyncs
+        << ",\"eviction_write_backs\":" << stats.evictionWriteBacks << ",\"writer_throttles\":" << stats.writerThrottles
+        << ",\"tier_hits\":" << stats.tierHits << ",\"tier_stores\":" << stats.tierStores << ",\"tier_bypasses\":" << stats.tierBypasses
+        << ",\"tier_bytes_in\":" << stats.tierBytesIn << ",\"tier_bytes_out\":" << stats.tierBytesOut
+        << ",\"tier_compression_ratio\":" << stats.compressionRatio()
+        << ",\"zero_fills\":" << stats.zeroFills << ",\"bytes_past_eof\":" << stats.bytesPastEof
+        << ",\"async_inline\":" << stats.asyncInline << ",\"async_queued\":" << stats.asyncQueued;
+    latencyToJson(out, "read", stats.latency[LATENCY_READ]);
+    latencyToJson(out, "write", stats.latency[LATENCY_WRITE]);
+    latencyToJson(out, "flush", stats.latency[LATENCY_FLUSH]);
+    out << "}";
+    return out.str();
+}
+
+CacheStatistics::CacheStatistics() : m_stripes(new Stripe[STRIPES]), m_start(std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < STRIPES; i++) {
+        Stripe& stripe = m_stripes[i];
+        for (auto& counter : stripe.counters) counter.store(0, std::memory_order_relaxed);
+        for (size_t op = 0; op < LATENCY_OP_COUNT; op++) {
+            for (auto& bucket : stripe.buckets[op]) bucket.store(0, std::memory_order_relaxed);
+            stripe.totalNs[op].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+CacheStatistics::~CacheStatistics() {
+    stopDump();
+}
+
+size_t CacheStatistics::stripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t index = nextStripe.fetch_add(1, std::memory_order_relaxed) % STRIPES; // 线程第一次统计时分配
+    return index;
+}
+
+void CacheStatistics::recordLatency(LatencyOp op, uint64_t ns) {
+    size_t bucket = ns == 0 ? 0 : 64 - __builtin_clzll(ns); // ns的二进制位数
+    if (bucket >= LatencyHistogram::BUCKETS) bucket = LatencyHistogram::BUCKETS - 1;
+    Stripe& stripe = m_stripes[CacheStatistics::stripe()];
+    stripe.buckets[op][bucket].fetch_add(1, std::memory_order_relaxed);
+    stripe.totalNs[op].fetch_add(ns, std::memory_order_relaxed);
+}
+
+CacheStats CacheStatistics::snapshot() const {
+    uint64_t counters[STAT_COUNTER_COUNT] = {};
+    CacheStats stats = {};
+    for (size_t i = 0; i < STRIPES; i++) {
+        const Stripe& stripe = m_stripes[i];
+        for (size_t c = 0; c < STAT_COUNTER_COUNT; c++) {
+            counters[c] += stripe.counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t op = 0; op < LATENCY_OP_COUNT; op++) {
+            LatencyHistogram& histogram = stats.latency[op];
+            for (size_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                uint64_t n = stripe.buckets[op][b].load(std::memory_order_relaxed);
+                histogram.buckets[b] += n;
+                histogram.count += n;
+            }
+            histogram.totalNs += stripe.totalNs[op].load(std::memory_order_relaxed);
+        }
+    }
+    stats.hits = counters[STAT_HITS];
+    stats.misses = counters[STAT_MISSES];
+    stats.evictions = counters[STAT_EVICTIONS];
+    stats.blocksWrittenBack = counters[STAT_BLOCKS_WRITTEN_BACK];
+    stats.bytesWrittenBack = counters[STAT_BYTES_WRITTEN_BACK];
+    stats.bytesSkipped = counters[STAT_BYTES_SKIPPED];
+    stats.bytesRead = counters[STAT_BYTES_READ];
+    stats.readCalls = counters[STAT_READ_CALLS];
+    stats.writeCalls = counters[STAT_WRITE_CALLS];
+    stats.readaheadBlocks = counters[STAT_READAHEAD_BLOCKS];
+    stats.readaheadHits = counters[STAT_READAHEAD_HITS];
+    stats.readaheadWasted = counters[STAT_READAHEAD_WASTED];
+    stats.journalBytes = counters[STAT_JOURNAL_BYTES];
+    stats.journalSyncs = counters[STAT_JOURNAL_SYNCS];
+    stats.evictionWriteBacks = counters[STAT_EVICTION_WRITE_BACKS];
+    stats.writerThrottles = counters[STAT_WRITER_THROTTLES];
+    stats.tierHits = counters[STAT_TIER_HITS];
+    stats.tierStores = counters[STAT_TIER_STORES];
+    stats.tierBypasses = counters[STAT_TIER_BYPASSES];
+    stats.tierBytesIn = counters[STAT_TIER_BYTES_IN];
+    stats.tierBytesOut = counters[STAT_TIER_BYTES_OUT];
+    stats.zeroFills = counters[STAT_ZERO_FILLS];
+    stats.bytesPastEof = counters[STAT_BYTES_PAST_EOF];
+    stats.asyncInline = counters[STAT_ASYNC_INLINE];
+    stats.asyncQueued = counters[STAT_ASYNC_QUEUED];
+    return stats;
+}
+
+void CacheStatistics::startDump(const std::string& path, std::chrono::milliseconds interval) {
+    stopDump();
+    FILE* file = fopen(path.c_str(), "a");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open stats file: " + path);
+    }
+    m_dumpStop = false;
+    m_dumpThread = std::thread([this, file, interval]() { this->dumpRun(file, interval); });
+}
+
+void CacheStatistics::stopDump() {
+    if (!m_dumpThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_dumpMutex);
+        m_dumpStop = true;
+    }
+    m_dumpCv.notify_all();
+    m_dumpThread.join();
+}
+
+void CacheStatistics::dumpRun(FILE* file, std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(m_dumpMutex);
+    bool stop = false;
+    while (!stop) {
+        stop = m_dumpCv.wait_for(lock, interval, [this]() { return m_dumpStop; });
+        long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count();
+        std::string json = statsToJson(snapshot());
+        fprintf(file, "{\"elapsed_ms\":%lld,%s\n", elapsed, json.c_str() + 1); // 在对象开头插入时间戳
+        fflush(file);
+    }
+    fclose(file);
+}
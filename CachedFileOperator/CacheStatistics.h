@@ -0,0 +1,154 @@
+#ifndef CacheStatistics_H
+#define CacheStatistics_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 计数器
+enum StatCounter : unsigned {
+    STAT_HITS, //块命中次数
+    STAT_MISSES, //块未命中次数
+    STAT_EVICTIONS, //淘汰次数
+    STAT_BLOCKS_WRITTEN_BACK, //写回的脏块数
+    STAT_BYTES_WRITTEN_BACK, //写回文件的字节数
+    STAT_BYTES_SKIPPED, //因块未被修改而省去写回的字节数
+    STAT_BYTES_READ, //从文件读入缓存的字节数
+    STAT_READ_CALLS, //读入块时发出的系统调用次数
+    STAT_WRITE_CALLS, //写回时发出的系统调用次数
+    STAT_READAHEAD_BLOCKS, //预读的块数
+    STAT_READAHEAD_HITS, //预读后被访问的块数
+    STAT_READAHEAD_WASTED, //预读后未被访问就被淘汰的块数
+    STAT_JOURNAL_BYTES, //写入日志的数据字节数
+    STAT_JOURNAL_SYNCS, //日志的fdatasync次数
+    STAT_EVICTION_WRITE_BACKS, //淘汰时在前台写回的脏块数
+    STAT_WRITER_THROTTLES, //脏块超过上限、写入被限速的次数
+    STAT_TIER_HITS, //在压缩二级缓存中命中的块数
+    STAT_TIER_STORES, //存入压缩二级缓存的块数
+    STAT_TIER_BYPASSES, //压缩效果不足、未存入的块数
+    STAT_TIER_BYTES_IN, //存入的块压缩前的字节数
+    STAT_TIER_BYTES_OUT, //存入的块压缩后的字节数
+    STAT_ZERO_FILLS, //已知全为0（文件数据上界之后或空洞中）、未读文件直接填0的块数
+    STAT_BYTES_PAST_EOF, //读取文件末尾之后、直接填0返回的字节数
+    STAT_ASYNC_INLINE, //全部命中、在调用线程中直接完成的异步请求数
+    STAT_ASYNC_QUEUED, //未全部命中、交给工作线程完成的异步请求数
+    STAT_COUNTER_COUNT
+};
+
+// 记录延迟的操作
+enum LatencyOp : unsigned {
+    LATENCY_READ, //read()/pread()
+    LATENCY_WRITE, //write()/pwrite()
+    LATENCY_FLUSH, //flush()
+    LATENCY_OP_COUNT
+};
+
+// 延迟直方图：桶i统计延迟在[2^(i-1), 2^i) ns内的次数（桶0为0ns）
+typedef struct LatencyHistogram{
+    static const size_t BUCKETS = 48; // 最大约2^47 ns，即39小时
+    uint64_t buckets[BUCKETS]; //各桶的次数
+    uint64_t count; //总次数
+    uint64_t totalNs; //总延迟
+    double percentile(double p) const; // 第p（0 ~ 1）分位数的估计值，桶内线性插值
+    double mean() const; // 平均延迟
+}LatencyHistogram;
+
+typedef struct CacheStats{
+    size_t hits; //块命中次数
+    size_t misses; //块未命中次数
+    size_t evictions; //淘汰次数
+    size_t blocksWrittenBack; //写回的脏块数
+    size_t bytesWrittenBack; //写回文件的字节数（只有脏块才写回）
+    size_t bytesSkipped; //因块未被修改而省去写回的字节数
+    size_t bytesRead; //从文件读入缓存的字节数
+    size_t readCalls; //读入块时发出的系统调用次数（io_uring时一批读入只需一次）
+    size_t writeCalls; //写回时发出的系统调用次数（相邻脏块合并为一次写入，io_uring时一次flush的所有写入只需一次）
+    size_t readaheadBlocks; //预读的块数
+    size_t readaheadHits; //预读后被访问的块数
+    size_t readaheadWasted; //预读后未被访问就被淘汰的块数
+    size_t journalBytes; //写入日志的数据字节数
+    size_t journalSyncs; //日志的fdatasync次数（成组提交时多个写入共用一次）
+    size_t evictionWriteBacks; //淘汰时在前台写回的脏块数（写入因等待写回而变慢的次数）
+    size_t writerThrottles; //脏块超过上限、写入被限速的次数
+    size_t tierHits; //在压缩二级缓存中命中的块数（同时计入misses）
+    size_t tierStores; //存入压缩二级缓存的块数
+    size_t tierBypasses; //压缩效果不足、未存入的块数
+    size_t tierBytesIn; //存入的块压缩前的字节数
+    size_t tierBytesOut; //存入的块压缩后的字节数
+    size_t zeroFills; //已知全为0、未读文件直接填0的块数
+    size_t bytesPastEof; //读取文件末尾之后、直接填0返回的字节数
+    size_t asyncInline; //全部命中、在调用线程中直接完成的异步请求数
+    size_t asyncQueued; //未全部命中、交给工作线程完成的异步请求数（没有工作线程时在调用线程中同步完成）
+    LatencyHistogram latency[LATENCY_OP_COUNT]; //各操作的延迟，下标为LatencyOp
+    double hitRatio() const; // 命中率
+    double compressionRatio() const; // 二级缓存的压缩比（压缩前/压缩后）
+}CacheStats;
+
+std::string statsToJson(const CacheStats& stats); // 转为一行JSON
+
+/*
+无锁统计。计数器和直方图分成多个按缓存行对齐的条带，每个线程固定使用其中一个（线程数不超过条带数时互不共享），
+热路径上只有一次不竞争的原子加；snapshot()时把所有条带相加。
+*/
+class CacheStatistics {
+public:
+    static const size_t STRIPES = 64; // 条带数
+
+    CacheStatistics();
+    ~CacheStatistics(); // 停止定期输出
+    CacheStatistics(const CacheStatistics&) = delete;
+    CacheStatistics& operator=(const CacheStatistics&) = delete;
+
+    void add(StatCounter counter, uint64_t value = 1) {
+        m_stripes[stripe()].counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+    void recordLatency(LatencyOp op, uint64_t ns); // 记录一次操作的延迟
+    CacheStats snapshot() const; // 所有条带的累计值，不阻塞正在统计的线程
+
+    // 每隔interval把快照以JSON行追加到文件中，停止时再输出一行。path无法打开时抛出异常
+    void startDump(const std::string& path, std::chrono::milliseconds interval);
+    void stopDump();
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> counters[STAT_COUNTER_COUNT];
+        std::atomic<uint64_t> buckets[LATENCY_OP_COUNT][LatencyHistogram::BUCKETS];
+        std::atomic<uint64_t> totalNs[LATENCY_OP_COUNT];
+    };
+    static size_t stripe(); // 当前线程使用的条带
+    void dumpRun(FILE* file, std::chrono::milliseconds interval); // 定期输出线程
+
+    std::unique_ptr<Stripe[]> m_stripes;
+    std::chrono::steady_clock::time_point m_start; // 创建时间，输出的时间戳相对于它
+
+    std::thread m_dumpThread;
+    std::mutex m_dumpMutex;
+    std::condition_variable m_dumpCv;
+    bool m_dumpStop = false;
+};
+
+// 记录一个作用域的延迟
+class LatencyTimer {
+public:
+    LatencyTimer(CacheStatistics* stats, LatencyOp op) // stats为nullptr时不计时
+        : m_stats(stats), m_op(op) {
+        if (m_stats) m_start = std::chrono::steady_clock::now();
+    }
+    ~LatencyTimer() {
+        if (m_stats) {
+            m_stats->recordLatency(m_op, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+        }
+    }
+private:
+    CacheStatistics* m_stats;
+    LatencyOp m_op;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // CacheStatistics_H
@@ -1,26 +1,231 @@
 #include "CachedFileOperator.h"
+#include <algorithm>
+#include <exception>
+#include <sys/stat.h>
+#include <climits>
+#include <cerrno>
 
-CachedFileOperator* CachedFileOperator::m_CFO = nullptr;
+const size_t CachedFileOperator::READAHEAD_MIN_WINDOW;
+const size_t CachedFileOperator::READAHEAD_MAX_WINDOW;
+const size_t CachedFileOperator::IO_BATCH_BLOCKS;
+std::mutex CachedFileOperator::s_instancesMutex;
+std::vector<CachedFileOperator*> CachedFileOperator::s_instances;
 
-CachedFileOperator::CachedFileOperator()
-    : p_cacheBuffer(new char[CACHE_BUFFER_SIZE]), m_cache(CACHE_MAX_BLOCK), m_fd(-1) {
+// 检查配置，返回槽数上限
+static size_t checkConfig(const CacheConfig& config) {
+    if (config.blockSize == 0 || config.blockSize % CachedFileOperator::DIRECT_IO_ALIGNMENT != 0) { // 块地址与块大小都要满足O_DIRECT的对齐要求
+        throw std::runtime_error("Invalid block size: " + std::to_string(config.blockSize));
+    }
+    size_t maxCacheSize = config.maxCacheSize == 0 ? config.cacheSize : config.maxCacheSize;
+    if (config.cacheSize > maxCacheSize) {
+        throw std::runtime_error("Cache size exceeds the memory budget");
+    }
+    size_t maxSlots = maxCacheSize / config.blockSize;
+    size_t slots = config.cacheSize / config.blockSize;
+    if (config.numShards == 0 || config.numShards > slots) {
+        throw std::runtime_error("Invalid number of cache shards: " + std::to_string(config.numShards));
+    }
+    if (config.dirtyRatio > 100 || config.dirtyBackgroundRatio >= config.dirtyRatio) {
+        throw std::runtime_error("Invalid dirty ratios: " + std::to_string(config.dirtyBackgroundRatio) + "/" + std::to_string(config.dirtyRatio));
+    }
+    return maxSlots;
+}
+
+const char* arenaPagesName(ArenaPages pages) {
+    switch (pages) {
+    case ArenaPages::NORMAL: return "normal";
+    case ArenaPages::TRANSPARENT: return "THP";
+    case ArenaPages::HUGETLB: return "hugetlb";
+    }
+    return "UNKNOWN";
+}
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // x86-64的大页大小
+
+void CachedFileOperator::mapArena(ArenaPages pages) {
+    // 只保留地址空间，页面在第一次访问（或预先分配）时才分配。映射地址至少按页对齐，满足O_DIRECT的要求
+    size_t size = m_maxSlots * m_blockSize;
+    size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (pages == ArenaPages::HUGETLB) {
+        // 不加MAP_NORESERVE：映射时就从大页池预留，池中大页不足时映射失败，而不是在访问时收到SIGBUS
+        void* p = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            p_cacheBuffer = std::unique_ptr<char[], ArenaUnmap>(static_cast<char*>(p), ArenaUnmap{hugeSize});
+            m_arenaPages = ArenaPages::HUGETLB;
+            return;
+        }
+        pages = ArenaPages::TRANSPARENT; // 大页池为空或内核不支持
+    }
+    if (pages == ArenaPages::TRANSPARENT) {
+        // 多映射一个大页再裁掉首尾，使缓存区按2MB对齐，每个大页都能整页映射
+        void* p = mmap(nullptr, hugeSize + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error("Failed to allocate cache buffer");
+        }
+        char* raw = static_cast<char*>(p);
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+        if (aligned > raw) munmap(raw, aligned - raw);
+        munmap(aligned + hugeSize, raw + hugeSize + HUGE_PAGE_SIZE - (aligned + hugeSize));
+        p_cacheBuffer = std::unique_ptr<char[], ArenaUnmap>(aligned, ArenaUnmap{hugeSize});
+        if (madvise(aligned, hugeSize, MADV_HUGEPAGE) == 0) { // 内核未开启透明大页时失败，按普通页使用
+            m_arenaPages = ArenaPages::TRANSPARENT;
+            return;
+        }
+        m_arenaPages = ArenaPages::NORMAL;
+        return;
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error("Failed to allocate cache buffer");
+    }
+    p_cacheBuffer = std::unique_ptr<char[], ArenaUnmap>(static_cast<char*>(p), ArenaUnmap{size});
+    m_arenaPages = ArenaPages::NORMAL;
+}
+
+void CachedFileOperator::prefaultArena(size_t begin, size_t end) {
+    if (!m_prefault || begin >= end) return;
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(p_cacheBuffer.get() + begin, end - begin, MADV_POPULATE_WRITE) == 0) return; // 一次系统调用分配全部物理页
+#endif
+    // 内核不支持MADV_POPULATE_WRITE（5.14之前）时逐页写入
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    for (size_t off = begin; off < end; off += pageSize) {
+        p_cacheBuffer[off] = 0;
+    }
+}
+
+static CacheConfig makeConfig(size_t numShards, EvictionPolicyType policy, bool readahead, IoEngineType ioEngine) {
+    CacheConfig config;
+    config.numShards = numShards;
+    config.policy = policy;
+    config.readahead = readahead;
+    config.ioEngine = ioEngine;
+    return config;
+}
+
+CachedFileOperator::CachedFileOperator(size_t numShards, EvictionPolicyType policy, bool readahead, IoEngineType ioEngine)
+    : CachedFileOperator(makeConfig(numShards, policy, readahead, ioEngine)) {
+}
+
+CachedFileOperator::CachedFileOperator(const CacheConfig& config)
+    : m_blockSize(config.blockSize), m_maxSlots(checkConfig(config)), m_activeSlots(config.cacheSize / config.blockSize),
+      m_prefault(config.prefault), m_policyType(config.policy), m_numShards(config.numShards),
+      m_latencyHistograms(config.latencyHistograms), m_io(createIoEngine(config.ioEngine)),
+      m_journalCheckpointSize(config.journalCheckpointSize), m_backgroundWriteback(config.backgroundWriteback),
+      m_dirtyBackgroundRatio(config.dirtyBackgroundRatio), m_dirtyRatio(config.dirtyRatio), m_files(new FileInfo[MAX_OPEN_FILES]),
+      m_readahead(config.readahead) {
+    mapArena(config.pages);
+    prefaultArena(0, m_activeSlots * m_blockSize);
+    size_t numShards = m_numShards;
+    m_shards.reset(new CacheShard[numShards]);
+    for (size_t i = 0; i < m_maxSlots; i++) { // 缓存块轮流分给各分片，槽按上限一次建好，resize()时不再移动
+        BlockInfo info;
+        info.key = 0;
+        info.cacheBufferOffset = i * m_blockSize;
+        info.blockValidSize = 0;
+        info.dirty = false;
+        info.loading = false;
+        info.prefetched = false;
+        info.pins = 0;
+        info.writingBack = false;
+        info.version = 0;
+        m_shards[i % numShards].slots.push_back(info);
+    }
+    for (size_t i = 0; i < numShards; i++) {
+        CacheShard& shard = m_shards[i];
+        shard.capacity = (m_activeSlots + numShards - 1 - i) / numShards; // 全局槽号小于m_activeSlots的槽
+        shard.index.reserve(shard.slots.size()); // 按上限分配，之后的查找、插入、删除都不再分配内存
+        for (size_t slot = shard.capacity; slot > 0; slot--) { // 从低地址开始分配
+            shard.freeSlots.push_back(slot - 1);
+        }
+        shard.policy = createEvictionPolicy(config.policy, shard.slots.size()); // 策略按上限创建，扩容时无需重建
+        shard.dirtyList.reset(new SlotLists(shard.slots.size(), 1));
+        if (config.compressedTierSize > 0) { // 按分片平分，由分片的锁保护
+            shard.tier.reset(new CompressedTier(config.compressedTierSize / numShards, m_blockSize));
+        }
+    }
+    setDirtyLimits(m_activeSlots);
+    if (!config.statsDumpPath.empty()) { // 先于预读线程启动，打开失败时构造函数可以直接抛出
+        m_stats.startDump(config.statsDumpPath, std::chrono::milliseconds(config.statsDumpIntervalMs));
+    }
+    if (!config.tracePath.empty()) {
+        m_trace.start(config.tracePath);
+    }
+    if (m_readahead) {
+        m_readaheadThread = std::thread([this]() { this->readaheadRun(); });
+    }
+    for (size_t i = 0; i < config.asyncWorkers; i++) {
+        m_asyncThreads.emplace_back([this]() { this->asyncRun(); });
+    }
+    if (m_backgroundWriteback) {
+        m_writebackThread = std::thread([this]() { this->writebackRun(); });
+    }
+
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    static bool registered = false;
+    if (!registered) { // 第一个实例创建时注册退出处理
+        registered = true;
+        atexit(&CachedFileOperator::OnProcessExit); //处理程序的正常退出和意外退出
+        std::signal(SIGSEGV, signalHandler);
+        std::signal(SIGTERM, signalHandler);
+        std::signal(SIGABRT, signalHandler);
+    }
+    s_instances.push_back(this);
 }
 
 CachedFileOperator::~CachedFileOperator() {
-    
+    {
+        std::lock_guard<std::mutex> lock(s_instancesMutex);
+        s_instances.erase(std::remove(s_instances.begin(), s_instances.end(), this), s_instances.end());
+    }
+    if (!m_asyncThreads.empty()) { // 先完成未完成的异步请求
+        {
+            std::lock_guard<std::mutex> lock(m_asyncMutex);
+            m_asyncStop = true;
+        }
+        m_asyncCv.notify_all();
+        for (std::thread& thread : m_asyncThreads) {
+            thread.join();
+        }
+    }
+    if (m_readaheadThread.joinable()) { // 先停止预读线程，再关闭文件
+        {
+            std::lock_guard<std::mutex> lock(m_readaheadMutex);
+            m_readaheadStop = true;
+        }
+        m_readaheadCv.notify_all();
+        m_readaheadThread.join();
+    }
+    if (m_writebackThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_writebackMutex);
+            m_writebackStop = true;
+        }
+        m_writebackCv.notify_all();
+        m_throttleCv.notify_all();
+        m_writebackThread.join();
+    }
+    for (size_t fh = 0; fh < MAX_OPEN_FILES; fh++) {
+        if (m_files[fh].fd == -1) continue;
+        try {
+            close(fh); // 析构时写回并关闭所有文件
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << "Error during close: " << e.what() << std::endl;
+        }
+    }
 }
 
 void CachedFileOperator::OnProcessExit()
 {
-    CachedFileOperator* cfo = CachedFileOperator::getInstance();
-    if(cfo != nullptr){
+    std::lock_guard<std::mutex> lock(s_instancesMutex);
+    for (CachedFileOperator* cfo : s_instances) {
         try {
             cfo->flush(); // 确保缓存数据写入文件
-        } 
+        }
         catch (const std::runtime_error& e) {
             std::cerr << "Error during flush: " << e.what() << std::endl;
         }
-        cfo->close(); //退出时关闭文件
     }
 }
 
@@ -30,213 +235,1846 @@ void CachedFileOperator::signalHandler(int signal) {
     exit(signal); // 退出程序
 }
 
-void CachedFileOperator::flush() {
-    if(m_fd == -1){
-        std::cout << "In flush(): No specified file" << std::endl;
+size_t CachedFileOperator::makeBlockKey(int fh, size_t blockIndex) {
+    return (static_cast<size_t>(fh) << 48) | blockIndex;
+}
+
+int CachedFileOperator::keyFile(size_t key) {
+    return static_cast<int>(key >> 48);
+}
+
+size_t CachedFileOperator::keyBlock(size_t key) {
+    return key & ((static_cast<size_t>(1) << 48) - 1);
+}
+
+static const size_t MAX_KNOWN_HOLES = 4096; // 打开文件时最多查找的空洞数，碎片很多的文件只记录前面的部分
+
+// 用SEEK_HOLE/SEEK_DATA查出[0, fileSize)中的空洞；文件系统不支持时只有文件末尾这个隐含的空洞，结果为空
+static std::map<size_t, size_t> findHoles(int fd, size_t fileSize) {
+    std::map<size_t, size_t> holes;
+    size_t pos = 0;
+    while (pos < fileSize && holes.size() < MAX_KNOWN_HOLES) {
+        off_t hole = ::lseek(fd, pos, SEEK_HOLE);
+        if (hole == -1 || static_cast<size_t>(hole) >= fileSize) break;
+        off_t data = ::lseek(fd, hole, SEEK_DATA);
+        if (data == -1 && errno != ENXIO) break;
+        size_t end = data == -1 ? fileSize : std::min<size_t>(data, fileSize); // ENXIO：空洞一直延伸到文件末尾
+        holes[hole] = end;
+        pos = end;
+    }
+    return holes;
+}
+
+static std::string journalPath(const std::string& fileName) {
+    return fileName + ".journal";
+}
+
+FileInfo& CachedFileOperator::getFile(int fh, const char* caller) {
+    if (fh < 0 || static_cast<size_t>(fh) >= MAX_OPEN_FILES || m_files[fh].fd == -1) {
+        throw std::runtime_error(std::string("In ") + caller + "(): Invalid file handle " + std::to_string(fh));
+    }
+    return m_files[fh];
+}
+
+CacheShard& CachedFileOperator::shardOf(size_t key) {
+    // 乘法哈希打散相邻块，使顺序访问也能均匀分布到各分片
+    size_t hash = (key * 0x9E3779B97F4A7C15ULL) >> 32;
+    return m_shards[hash % m_numShards];
+}
+
+size_t CachedFileOperator::writeBackLength(const FileInfo& file, size_t validSize) {
+    if (!file.direct) return validSize;
+    // O_DIRECT的写入长度必须对齐，块内有效数据之后都是0，多写的部分随后截断
+    return (validSize + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+}
+
+void CachedFileOperator::trimPadding(FileInfo& file, size_t writtenEnd) {
+    size_t fileSize = file.fileSize.load();
+    if (writtenEnd > fileSize && ::ftruncate(file.fd, fileSize) == -1) {
+        throw std::runtime_error("Failed to truncate file: " + file.fileName);
+    }
+}
+
+void CachedFileOperator::disableDirect(FileInfo& file) {
+    int flags = fcntl(file.fd, F_GETFL);
+    if (flags == -1 || fcntl(file.fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+        throw std::runtime_error("Failed to disable O_DIRECT: " + file.fileName);
+    }
+    file.direct = false;
+}
+
+void CachedFileOperator::writeBack(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    if (!info.dirty) { // 干净块与文件内容一致，无需写回
+        m_stats.add(STAT_BYTES_SKIPPED, info.blockValidSize);
         return;
     }
-    for (const auto& block : m_accessOrder) { // 遍历访问顺序列表
-        auto it = m_cache.find(block);
-        if (it != m_cache.end()) { // 如果缓存中有该块
-            size_t blockIndex = it->first;
-            size_t offset = it->second.cacheBufferOffset; // 获取缓存偏移量
-            size_t blockValidSize = it->second.blockValidSize; // 获取块有效大小
-            lseek(blockIndex * BLOCK_SIZE, SEEK_SET);
-            ssize_t writtenBytes = ::write(m_fd, p_cacheBuffer.get() + offset, blockValidSize); // 写入文件
-            if (writtenBytes == -1) { 
-                throw std::runtime_error("Failed to write cache to file");
+    FileInfo& file = m_files[keyFile(info.key)];
+    off_t fileOffset = keyBlock(info.key) * m_blockSize;
+    size_t length = writeBackLength(file, info.blockValidSize);
+    size_t calls = 0;
+    ssize_t writtenBytes = m_io->writeAt(file.fd, p_cacheBuffer.get() + info.cacheBufferOffset, length, fileOffset, &calls);
+    if (writtenBytes == -1 && errno == EINVAL && file.direct) { // 文件系统拒绝O_DIRECT写入
+        disableDirect(file);
+        length = info.blockValidSize;
+        writtenBytes = m_io->writeAt(file.fd, p_cacheBuffer.get() + info.cacheBufferOffset, length, fileOffset, &calls);
+    }
+    m_stats.add(STAT_WRITE_CALLS, calls);
+    if (writtenBytes == -1) {
+        throw std::runtime_error("Failed to write cache to file: " + file.fileName);
+    }
+    if (static_cast<size_t>(writtenBytes) < length) { // 部分写入，同步写完剩余部分
+        std::vector<struct iovec> rest = {{p_cacheBuffer.get() + info.cacheBufferOffset + writtenBytes, length - writtenBytes}};
+        writeBackRun(file, fileOffset + writtenBytes, rest);
+    }
+    trimPadding(file, fileOffset + length);
+    m_stats.add(STAT_BYTES_WRITTEN_BACK, info.blockValidSize);
+    m_stats.add(STAT_BLOCKS_WRITTEN_BACK);
+    markClean(shard, slot);
+}
+
+void CachedFileOperator::markDirty(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    info.version++;
+    if (info.dirty) return;
+    info.dirty = true;
+    shard.dirtyList->pushFront(0, slot);
+    if (m_dirtyBlocks.fetch_add(1) + 1 == m_dirtyBackgroundLimit.load() + 1) { // 刚超过后台阈值，唤醒后台线程
+        std::lock_guard<std::mutex> lock(m_writebackMutex);
+        m_writebackCv.notify_one();
+    }
+}
+
+void CachedFileOperator::markClean(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    if (!info.dirty) return;
+    info.dirty = false;
+    shard.dirtyList->remove(slot);
+    m_dirtyBlocks.fetch_sub(1);
+}
+
+void CachedFileOperator::writeBackRun(FileInfo& file, off_t fileOffset, std::vector<struct iovec>& iov) {
+    size_t index = 0;
+    while (index < iov.size()) {
+        int count = std::min(iov.size() - index, static_cast<size_t>(IOV_MAX));
+        ssize_t writtenBytes = ::pwritev(file.fd, &iov[index], count, fileOffset);
+        if (writtenBytes == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL && file.direct) { // 文件系统拒绝O_DIRECT写入，退回普通写入后重试
+                disableDirect(file);
+                continue;
             }
+            throw std::runtime_error("Failed to write cache to file: " + file.fileName);
         }
-        else{
-            std::cout <<"In flush(): Loop by access order, but can not find block in cache" << std::endl;
+        m_stats.add(STAT_WRITE_CALLS);
+        m_stats.add(STAT_BYTES_WRITTEN_BACK, writtenBytes);
+        fileOffset += writtenBytes;
+        // 跳过已写完的部分，处理部分写入的情况
+        while (writtenBytes > 0) {
+            if (static_cast<size_t>(writtenBytes) >= iov[index].iov_len) {
+                writtenBytes -= iov[index].iov_len;
+                index++;
+            } else {
+                iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + writtenBytes;
+                iov[index].iov_len -= writtenBytes;
+                writtenBytes = 0;
+            }
         }
     }
-    m_accessOrder.clear();
-    m_cache.clear();
 }
 
-void CachedFileOperator::close() {
-    if (m_fd != -1) { //如果当前打开了某个文件，将其关闭
-        ::close(m_fd);
-        m_fd = -1;
+void CachedFileOperator::flushBlocks(int fh) {
+    // 逐个分片收集脏块的键，不同时持有多个分片的锁
+    std::vector<size_t> keys;
+    for (size_t i = 0; i < m_numShards; i++) {
+        CacheShard& shard = m_shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.forEach([&](size_t key, size_t slot) {
+            if (fh != -1 && keyFile(key) != fh) return;
+            BlockInfo& info = shard.slots[slot];
+            if (info.loading) return; // 正在读入的块一定是干净的
+            if (info.dirty) {
+                keys.push_back(key);
+            } else {
+                m_stats.add(STAT_BYTES_SKIPPED, info.blockValidSize);
+            }
+        });
+    }
+    // 块键的高位是句柄、低位是块号，排序后同一文件的相邻块连续排列
+    std::sort(keys.begin(), keys.end());
+    while (!keys.empty()) {
+        keys = flushBatch(keys);
     }
 }
 
-//单例模式
-CachedFileOperator* CachedFileOperator::getInstance() {
-    if(m_CFO == nullptr){
-        m_CFO = new CachedFileOperator;
-        atexit(&CachedFileOperator::OnProcessExit); //处理程序的正常退出和意外退出
-        std::signal(SIGSEGV, signalHandler); 
-        std::signal(SIGTERM, signalHandler); 
-        std::signal(SIGABRT, signalHandler); 
+std::vector<size_t> CachedFileOperator::flushBatch(const std::vector<size_t>& keys) {
+    // 与后台写回相同：固定脏块并记下版本，释放分片锁后提交，读写者在写回I/O期间照常访问各分片。
+    // 每个分片至少留一个可淘汰的槽，放不下的块留到下一批
+    struct FlushBlock {
+        size_t key;
+        bool full; // 固定时块是否整块有效，整块才与下一块合并
+        BlockWriteback block;
+    };
+    std::vector<size_t> deferred;
+    std::vector<FlushBlock> dirtyBlocks;
+    for (size_t key : keys) {
+        CacheShard& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t slot = shard.index.find(key);
+        if (slot == BlockTable::NOT_FOUND) continue; // 已被淘汰，淘汰时已写回
+        BlockInfo& info = shard.slots[slot];
+        if (info.loading || !info.dirty) continue; // 已被写回
+        if (info.pins == 0 && shard.loadingCount + shard.pinnedCount + shard.writebackPinned + 1 >= shard.capacity) {
+            deferred.push_back(key);
+            continue;
+        }
+        pinForWriteback(shard, slot);
+        size_t length = writeBackLength(m_files[keyFile(key)], info.blockValidSize);
+        dirtyBlocks.push_back({key, info.blockValidSize == m_blockSize, {&shard, slot, info.version, {p_cacheBuffer.get() + info.cacheBufferOffset, length}}});
+    }
+    if (dirtyBlocks.empty()) { // 分片被视图与读入占满，一块也固定不了：在分片锁内逐块写回
+        for (size_t key : deferred) {
+            CacheShard& shard = shardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size_t slot = shard.index.find(key);
+            if (slot != BlockTable::NOT_FOUND && !shard.slots[slot].loading) {
+                writeBack(shard, slot);
+            }
+        }
+        return {};
+    }
+    auto unpinAll = [&]() {
+        for (FlushBlock& dirty : dirtyBlocks) {
+            std::lock_guard<std::mutex> lock(dirty.block.shard->mutex);
+            unpinForWriteback(*dirty.block.shard, dirty.block.slot);
+        }
+    };
+
+    // 每段连续的脏块合并为一个写请求（超过IOV_MAX时拆分），所有写请求作为一批提交
+    struct WriteRun {
+        size_t firstDirty, numDirty; // 在dirtyBlocks中的范围
+        size_t firstRequest, numRequests; // 在requests中的范围
+    };
+    std::vector<struct iovec> iov;
+    iov.reserve(dirtyBlocks.size()); // 请求直接引用iov中的元素，不能重新分配
+    std::vector<WriteRun> runs;
+    std::vector<IoRequest> requests;
+    size_t runStart = 0;
+    for (size_t i = 0; i < dirtyBlocks.size(); i++) {
+        const FileInfo& file = m_files[keyFile(dirtyBlocks[i].key)];
+        iov.push_back(dirtyBlocks[i].block.iov);
+        // 下一块紧邻且本块是整块时，继续合并到同一次写回中
+        bool continues = i + 1 < dirtyBlocks.size()
+            && dirtyBlocks[i + 1].key == dirtyBlocks[i].key + 1
+            && dirtyBlocks[i].full;
+        if (continues) continue;
+
+        size_t firstKey = dirtyBlocks[runStart].key;
+        WriteRun run = {runStart, i + 1 - runStart, requests.size(), 0};
+        for (size_t j = runStart; j <= i; j += IOV_MAX) {
+            int count = std::min(i + 1 - j, static_cast<size_t>(IOV_MAX));
+            off_t fileOffset = (keyBlock(firstKey) + j - runStart) * m_blockSize;
+            requests.push_back({file.fd, true, &iov[j], count, fileOffset, 0, 0});
+            run.numRequests++;
+        }
+        runs.push_back(run);
+        runStart = i + 1;
+    }
+    try {
+        m_stats.add(STAT_WRITE_CALLS, m_io->submit(requests.data(), requests.size()));
+
+        for (const WriteRun& run : runs) {
+            FileInfo& file = m_files[keyFile(dirtyBlocks[run.firstDirty].key)];
+            off_t runEnd = 0;
+            for (size_t r = run.firstRequest; r < run.firstRequest + run.numRequests; r++) {
+                IoRequest& request = requests[r];
+                size_t length = 0;
+                for (int k = 0; k < request.iovcnt; k++) {
+                    length += request.iov[k].iov_len;
+                }
+                runEnd = request.offset + length;
+                if (request.result == -1 && !(request.error == EINVAL && file.direct)) {
+                    throw std::runtime_error("Failed to write cache to file: " + file.fileName);
+                }
+                size_t writtenBytes = request.result == -1 ? 0 : request.result;
+                m_stats.add(STAT_BYTES_WRITTEN_BACK, writtenBytes);
+                if (writtenBytes == length) continue;
+
+                // 部分写入或文件系统拒绝O_DIRECT写入：剩余部分同步写完
+                std::vector<struct iovec> rest(request.iov, request.iov + request.iovcnt);
+                size_t skip = writtenBytes;
+                while (skip >= rest.front().iov_len) {
+                    skip -= rest.front().iov_len;
+                    rest.erase(rest.begin());
+                }
+                rest.front().iov_base = static_cast<char*>(rest.front().iov_base) + skip;
+                rest.front().iov_len -= skip;
+                writeBackRun(file, request.offset + writtenBytes, rest);
+            }
+            trimPadding(file, runEnd);
+            m_stats.add(STAT_BLOCKS_WRITTEN_BACK, run.numDirty);
+        }
+    }
+    catch (const std::runtime_error&) { // 解除保护，否则这些块再也不能被淘汰；它们仍是脏块
+        unpinAll();
+        throw;
+    }
+
+    // 写回期间被修改的块仍是脏块，由下次写回处理
+    for (FlushBlock& dirty : dirtyBlocks) {
+        CacheShard& shard = *dirty.block.shard;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.slots[dirty.block.slot].version == dirty.block.version) {
+            markClean(shard, dirty.block.slot);
+        }
+        unpinForWriteback(shard, dirty.block.slot);
+    }
+    return deferred;
+}
+
+void CachedFileOperator::dropFileBlocks(CacheShard& shard, int fh) {
+    shard.index.eraseIf([&](size_t key, size_t slot) {
+        if (keyFile(key) != fh) return false;
+        markClean(shard, slot); // 写回失败时丢弃的脏块
+        shard.policy->onRemove(slot);
+        shard.freeSlots.push_back(slot);
+        return true;
+    });
+    if (shard.tier) {
+        shard.tier->eraseIf([fh](size_t key) { return keyFile(key) == fh; });
     }
-    return m_CFO;
 }
 
-void CachedFileOperator::open(const std::string& fileName) { // 按文件名打开文件
-    m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | O_DIRECT);
-    if (m_fd == -1) {
+size_t CachedFileOperator::cacheSize() {
+    std::lock_guard<std::mutex> lock(m_resizeMutex);
+    return m_activeSlots * m_blockSize;
+}
+
+size_t CachedFileOperator::resize(size_t cacheSize) {
+    std::lock_guard<std::mutex> resizeLock(m_resizeMutex);
+    std::lock_guard<std::mutex> writebackLock(m_writebackRoundMutex); // 等待后台写回解除固定，缩小时才能淘汰这些块
+    size_t slots = std::min(std::max(cacheSize / m_blockSize, m_numShards), m_maxSlots);
+    size_t oldSlots = m_activeSlots;
+    prefaultArena(oldSlots * m_blockSize, slots * m_blockSize); // 在新槽加入空闲列表之前完成
+
+    // 槽i属于分片i % m_numShards，每个分片保留全局槽号小于slots的槽，启用的槽始终是缓存区开头连续的一段
+    for (size_t i = 0; i < m_numShards; i++) {
+        CacheShard& shard = m_shards[i];
+        size_t capacity = (slots + m_numShards - 1 - i) / m_numShards;
+        if (capacity > shard.capacity) { // 扩大：新启用的槽直接加入空闲槽
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (size_t slot = capacity; slot > shard.capacity; slot--) {
+                shard.freeSlots.push_back(slot - 1);
+            }
+            shard.capacity = capacity;
+            shard.loaded.notify_all();
+        } else if (capacity < shard.capacity) {
+            shrinkShard(shard, capacity); // 失败时已缩小的分片保持缩小，m_activeSlots不变，只在成功后释放内存
+        }
+    }
+    m_activeSlots = slots;
+    setDirtyLimits(slots);
+    if (slots < oldSlots) { // 停用的槽不再被访问，把内存还给系统，再次启用时读到的是0页
+        madvise(p_cacheBuffer.get() + slots * m_blockSize, (oldSlots - slots) * m_blockSize, MADV_DONTNEED);
+    }
+    return slots * m_blockSize;
+}
+
+void CachedFileOperator::shrinkShard(CacheShard& shard, size_t capacity) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    while (true) { // 等待要停用的槽读入完成；被固定的块无法淘汰
+        bool loading = false;
+        for (size_t slot = capacity; slot < shard.capacity; slot++) {
+            const BlockInfo& info = shard.slots[slot];
+            if (shard.index.find(info.key) != slot) continue; // 空闲槽
+            if (info.pins > 0) {
+                throw std::runtime_error("Cannot shrink cache: Block is pinned");
+            }
+            loading |= info.loading;
+        }
+        if (!loading) break;
+        shard.loaded.wait(lock);
+    }
+
+    // 先停止分配要停用的槽，再淘汰其中的块
+    shard.freeSlots.erase(std::remove_if(shard.freeSlots.begin(), shard.freeSlots.end(),
+        [capacity](size_t slot) { return slot >= capacity; }), shard.freeSlots.end());
+    for (size_t slot = shard.capacity; slot > capacity; slot--) {
+        BlockInfo& info = shard.slots[slot - 1];
+        if (shard.index.find(info.key) == slot - 1) {
+            try {
+                writeBack(shard, slot - 1);
+            }
+            catch (const std::runtime_error&) { // 块留在原槽中，分片停在当前大小，其中的空闲槽重新加入空闲列表
+                for (size_t free = capacity; free < shard.capacity; free++) {
+                    if (shard.index.find(shard.slots[free].key) != free) {
+                        shard.freeSlots.push_back(free);
+                    }
+                }
+                throw;
+            }
+            shard.policy->onRemove(slot - 1);
+            if (info.prefetched) {
+                m_stats.add(STAT_READAHEAD_WASTED);
+            }
+            shard.index.erase(info.key);
+            m_stats.add(STAT_EVICTIONS);
+        }
+        shard.capacity = slot - 1;
+    }
+}
+
+void CachedFileOperator::flush(int fh) {
+    FileInfo& file = getFile(fh, "flush");
+    m_trace.record(TRACE_FLUSH, fh, 0, 0);
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_FLUSH);
+    if (file.mapped) {
+        file.mapped->sync();
+        return;
+    }
+    if (file.journal) {
+        checkpoint(fh, file, 0);
+        return;
+    }
+    std::lock_guard<std::mutex> writebackLock(m_writebackRoundMutex);
+    flushBlocks(fh);
+}
+
+void CachedFileOperator::checkpoint(int fh, FileInfo& file, size_t minJournalSize) {
+    std::unique_lock<std::shared_mutex> lock(file.journalMutex); // 等待进行中的写入提交完成，新的写入等到检查点结束
+    if (file.journal->size() < minJournalSize) return; // 其他线程已做过检查点
+    std::unique_lock<std::mutex> writebackLock(m_writebackRoundMutex);
+    flushBlocks(fh);
+    writebackLock.unlock();
+    if (fdatasync(file.fd) == -1) {
+        throw std::runtime_error("Failed to sync file: " + file.fileName);
+    }
+    file.journal->reset(); // 日志中的写入都已在数据文件中落盘
+}
+
+void CachedFileOperator::flush() {
+    m_trace.record(TRACE_FLUSH, TRACE_ALL_FILES, 0, 0);
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_FLUSH);
+    {
+        std::lock_guard<std::mutex> writebackLock(m_writebackRoundMutex);
+        flushBlocks(-1);
+    }
+    std::lock_guard<std::mutex> lock(m_filesMutex); // 防止映射文件、日志文件同时被关闭
+    for (size_t fh = 0; fh < MAX_OPEN_FILES; fh++) {
+        if (m_files[fh].fd == -1) continue;
+        if (m_files[fh].mapped) {
+            m_files[fh].mapped->sync();
+        } else if (m_files[fh].journal) {
+            checkpoint(fh, m_files[fh], 0);
+        }
+    }
+}
+
+CacheStats CachedFileOperator::getStats() {
+    return m_stats.snapshot();
+}
+
+void CachedFileOperator::close(int fh) {
+    FileInfo& file = getFile(fh, "close");
+    if (file.mapped) { // 映射文件没有缓存块，也不会被预读
+        std::exception_ptr failure;
+        try {
+            file.mapped->sync();
+        }
+        catch (const std::runtime_error&) {
+            failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(m_filesMutex);
+        file.mapped.reset();
+        ::close(file.fd);
+        file.fd = -1;
+        file.fileName.clear();
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        return;
+    }
+    std::unique_lock<std::mutex> writebackLock(m_writebackRoundMutex); // 后台写回不再访问该文件的块
+    for (size_t i = 0; i < m_numShards; i++) { // 被固定的块还在被视图使用，不能释放
+        std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+        bool pinned = false;
+        m_shards[i].index.forEach([&](size_t key, size_t slot) {
+            pinned |= keyFile(key) == fh && m_shards[i].slots[slot].pins > 0;
+        });
+        if (pinned) {
+            throw std::runtime_error("In close(): File still has pinned blocks: " + file.fileName);
+        }
+    }
+    cancelReadahead(fh); // 预读线程不能再访问该文件
+    std::exception_ptr failure;
+    try {
+        flushBlocks(fh);
+    }
+    catch (const std::runtime_error&) {
+        failure = std::current_exception(); // 写回失败也要释放缓存块，避免残留在共享缓存中
+    }
+    if (file.journal && !failure) { // 数据已全部写回，同步后日志不再需要；写回失败时保留日志，下次open()时重放
+        if (fdatasync(file.fd) == 0) {
+            std::remove(journalPath(file.fileName).c_str());
+        } else {
+            failure = std::make_exception_ptr(std::runtime_error("Failed to sync file: " + file.fileName));
+        }
+    }
+    for (size_t i = 0; i < m_numShards; i++) {
+        std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+        dropFileBlocks(m_shards[i], fh);
+    }
+    writebackLock.unlock(); // 该文件已没有脏块，后台写回不会再访问它；先释放，避免与flush()的加锁顺序相反
+    std::lock_guard<std::mutex> lock(m_filesMutex);
+    file.journal.reset();
+    ::close(file.fd);
+    file.fd = -1;
+    file.fileName.clear();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+int CachedFileOperator::open(const std::string& fileName, unsigned flags) { // 按文件名打开文件
+    if ((flags & OPEN_DIRECT) && (flags & OPEN_MMAP)) {
+        throw std::runtime_error("OPEN_DIRECT cannot be combined with OPEN_MMAP: " + fileName);
+    }
+    if ((flags & OPEN_JOURNAL) && (flags & OPEN_MMAP)) {
+        throw std::runtime_error("OPEN_JOURNAL cannot be combined with OPEN_MMAP: " + fileName);
+    }
+    if (flags & OPEN_JOURNAL) { // 上次未正常关闭时，先把日志中已确认的写入重放到数据文件（不用O_DIRECT，记录未对齐）
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open file: " + fileName);
+        }
+        try {
+            Journal::replay(journalPath(fileName), fd);
+        }
+        catch (const std::runtime_error&) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+    bool direct = flags & OPEN_DIRECT;
+    int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | (direct ? O_DIRECT : 0), S_IRUSR | S_IWUSR);
+    if (fd == -1 && direct && errno == EINVAL) { // 文件系统不支持O_DIRECT，退回普通读写
+        direct = false;
+        fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    }
+    if (fd == -1) {
         throw std::runtime_error("Failed to open file: " + fileName);
     }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + fileName);
+    }
+    AccessHint hint = (flags & OPEN_SEQUENTIAL) ? AccessHint::SEQUENTIAL : (flags & OPEN_RANDOM) ? AccessHint::RANDOM : AccessHint::NORMAL;
+    std::unique_ptr<MappedFile> mapped;
+    if (flags & OPEN_MMAP) {
+        try {
+            mapped.reset(new MappedFile(fd, hint));
+        }
+        catch (const std::runtime_error&) {
+            ::close(fd);
+            throw;
+        }
+    } else if (hint != AccessHint::NORMAL) { // 只是提示，失败不影响读写
+        posix_fadvise(fd, 0, 0, hint == AccessHint::SEQUENTIAL ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+    }
+    std::map<size_t, size_t> holes;
+    if (!mapped) {
+        holes = findHoles(fd, st.st_size);
+    }
+    std::unique_ptr<Journal> journal;
+    if (flags & OPEN_JOURNAL) {
+        try {
+            journal.reset(new Journal(journalPath(fileName))); // 重放过的日志已落盘到数据文件，清空
+        }
+        catch (const std::runtime_error&) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    // 分配一个空闲句柄
+    std::lock_guard<std::mutex> lock(m_filesMutex);
+    size_t fh = 0;
+    while (fh < MAX_OPEN_FILES && m_files[fh].fd != -1) fh++;
+    if (fh == MAX_OPEN_FILES) {
+        ::close(fd);
+        throw std::runtime_error("Too many open files in cache: " + fileName);
+    }
+    FileInfo& file = m_files[fh];
+    file.pos = 0;
+    file.fileSize.store(st.st_size);
+    file.storedSize.store(st.st_size);
+    {
+        std::lock_guard<std::mutex> holesLock(file.holesMutex);
+        file.holes = std::move(holes);
+        file.hasHoles = !file.holes.empty();
+    }
+    file.raNextBlock = 0;
+    file.raWindow = READAHEAD_MIN_WINDOW;
+    file.raScheduledEnd = 0;
+    file.fileName = fileName;
+    file.direct = direct;
+    file.mapped = std::move(mapped);
+    file.journal = std::move(journal);
+    file.fd = fd;
+    return fh;
+}
+
+bool CachedFileOperator::isDirect(int fh) {
+    return getFile(fh, "isDirect").direct;
+}
+
+bool CachedFileOperator::isMapped(int fh) {
+    return getFile(fh, "isMapped").mapped != nullptr;
 }
 
-void CachedFileOperator::lseek(size_t offset, int whence) { //按指定方式获取文件偏移量
-    if(m_fd == -1){
-        throw std::runtime_error("In lseek(): File not specified");
+void CachedFileOperator::lseek(int fh, off_t offset, int whence) { //按指定方式设置句柄的文件偏移量
+    FileInfo& file = getFile(fh, "lseek");
+    off_t newPos;
+    switch (whence) {
+    case SEEK_SET:
+        newPos = offset;
+        break;
+    case SEEK_CUR:
+        newPos = file.pos + offset;
+        break;
+    case SEEK_END:
+        newPos = (file.mapped ? file.mapped->size() : file.fileSize.load()) + offset; // 文件大小包含尚未写回的缓存数据
+        break;
+    default:
+        throw std::runtime_error("In lseek(): Invalid whence");
     }
-    m_pos = ::lseek(m_fd, offset, whence); //保存文件当前偏移量
-    if (m_pos == -1) {
-        throw std::runtime_error("Failed to seek in file");
+    if (newPos < 0) {
+        throw std::runtime_error("Failed to seek in file: " + file.fileName);
     }
+    file.pos = newPos; //保存句柄当前偏移量
+}
+
+void CachedFileOperator::read(int fh, char* buffer, size_t size) {
+    FileInfo& file = getFile(fh, "read");
+    pread(fh, buffer, size, file.pos);
+    file.pos += size;
+}
+
+void CachedFileOperator::write(int fh, const char* data, size_t size) {
+    FileInfo& file = getFile(fh, "write");
+    pwrite(fh, data, size, file.pos);
+    file.pos += size;
 }
 
-void CachedFileOperator::read(char* buffer, size_t size) {
+void CachedFileOperator::pread(int fh, char* buffer, size_t size, off_t offset) {
     /*
-    从当前文件所在位置读取size大小的数据，输出到buffer中。
+    从文件的offset处读取size大小的数据，输出到buffer中。
 
     bufferOffset：缓冲区偏移量
     fileOffset：文件偏移量
     blockIndex：块索引
     blockOffset：块内偏移量
     */
-    if(m_fd == -1){
-        throw std::runtime_error("In read(): File not specified");
+    FileInfo& file = getFile(fh, "pread");
+    if (size == 0) return;
+    m_trace.record(TRACE_READ, fh, offset, size);
+    readRange(fh, file, buffer, size, offset);
+}
+
+void CachedFileOperator::readRange(int fh, FileInfo& file, char* buffer, size_t size, off_t offset) {
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_READ);
+    if (file.mapped) {
+        file.mapped->read(buffer, size, offset);
+        return;
     }
-    size_t bufferOffset = 0, fileOffset = m_pos;
-    size_t blockIndex = fileOffset / BLOCK_SIZE;
-    size_t blockOffset = fileOffset % BLOCK_SIZE;
-    if(blockOffset != 0){
-        // 将第一块需要的部分复制到buffer中
-        size_t firstBlockSize = std::min(size, BLOCK_SIZE - blockOffset);
-        memcpy(buffer + bufferOffset, readCache(blockIndex) + blockOffset, firstBlockSize);
-        blockIndex++;
-        bufferOffset += firstBlockSize;
+    size_t fileSize = file.fileSize.load();
+    if (offset + size > fileSize) { // 文件末尾之后的部分直接填0，不读文件也不占用缓存块
+        size_t valid = static_cast<size_t>(offset) >= fileSize ? 0 : fileSize - offset;
+        memset(buffer + valid, 0, size - valid);
+        m_stats.add(STAT_BYTES_PAST_EOF, size - valid);
+        size = valid;
+        if (size == 0) return;
     }
-    while(bufferOffset + BLOCK_SIZE <= size){
-        // 整块读取
-        memcpy(buffer + bufferOffset, readCache(blockIndex), BLOCK_SIZE);
-        blockIndex++;
-        bufferOffset += BLOCK_SIZE;
+    bool prefetchHit = false, miss = false;
+    size_t firstBlock = offset / m_blockSize;
+    size_t endBlock = (offset + size - 1) / m_blockSize + 1;
+    // 块blockIndex中落在[offset, offset + size)内的部分：缓冲区偏移量、块内偏移量、大小
+    auto piece = [&](size_t blockIndex, size_t& bufferOffset, size_t& blockOffset) {
+        size_t blockStart = blockIndex * m_blockSize;
+        size_t from = std::max<size_t>(offset, blockStart);
+        size_t to = std::min<size_t>(offset + size, blockStart + m_blockSize);
+        bufferOffset = from - offset;
+        blockOffset = from - blockStart;
+        return to - from;
+    };
+
+    for (size_t batchStart = firstBlock; batchStart < endBlock; batchStart += IO_BATCH_BLOCKS) {
+        size_t batchEnd = std::min(batchStart + IO_BATCH_BLOCKS, endBlock);
+        std::vector<BlockFill> fills;
+        std::vector<size_t> deferred; // 正在被其他线程读入或暂时无槽可用的块，批量读入后逐块处理
+
+        // 第一遍：命中的块直接复制，缺失的块分配槽，不在此等待，避免持有loading槽时等待其他分片
+        try {
+            for (size_t blockIndex = batchStart; blockIndex < batchEnd; blockIndex++) {
+                size_t bufferOffset, blockOffset;
+                size_t pieceSize = piece(blockIndex, bufferOffset, blockOffset);
+                size_t key = makeBlockKey(fh, blockIndex);
+                CacheShard& shard = shardOf(key);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                size_t slot = shard.index.find(key);
+                if (slot != BlockTable::NOT_FOUND && !shard.slots[slot].loading) {
+                    prefetchHit |= recordHit(shard, slot) == BlockAccess::PREFETCH_HIT;
+                    memcpy(buffer + bufferOffset, p_cacheBuffer.get() + shard.slots[slot].cacheBufferOffset + blockOffset, pieceSize);
+                    continue;
+                }
+                if (slot != BlockTable::NOT_FOUND || shardExhausted(shard)) {
+                    deferred.push_back(blockIndex);
+                    continue;
+                }
+                m_stats.add(STAT_MISSES);
+                miss = true;
+                shard.policy->onMiss(key);
+                slot = reserveSlot(shard, key);
+                beginFill(shard, slot);
+                fills.push_back({&shard, slot, blockIndex, -1});
+            }
+        }
+        catch (const std::runtime_error&) { // 淘汰时写回失败
+            abortFills(fills);
+            throw;
+        }
+
+        // 缺失的块作为一批读入，读入期间不持有任何锁
+        try {
+            readBlocks(file, fills);
+        }
+        catch (const std::runtime_error&) { // I/O引擎出错，释放读入中的槽，否则等待这些块的线程永远等不到
+            abortFills(fills);
+            throw;
+        }
+        bool failed = false;
+        for (BlockFill& fill : fills) {
+            CacheShard& shard = *fill.shard;
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            finishFill(shard, fill.slot, fill.result);
+            if (fill.result == -1) {
+                failed = true;
+                continue;
+            }
+            BlockInfo& info = shard.slots[fill.slot];
+            shard.policy->onInsert(fill.slot, info.key); // 交给淘汰策略管理
+            size_t bufferOffset, blockOffset;
+            size_t pieceSize = piece(fill.blockIndex, bufferOffset, blockOffset);
+            memcpy(buffer + bufferOffset, p_cacheBuffer.get() + info.cacheBufferOffset + blockOffset, pieceSize);
+        }
+        if (failed) {
+            throw std::runtime_error("Failed to read");
+        }
+
+        for (size_t blockIndex : deferred) {
+            size_t bufferOffset, blockOffset;
+            size_t pieceSize = piece(blockIndex, bufferOffset, blockOffset);
+            size_t key = makeBlockKey(fh, blockIndex);
+            CacheShard& shard = shardOf(key);
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            BlockAccess access = readCache(lock, shard, key, buffer + bufferOffset, pieceSize, blockOffset);
+            prefetchHit |= access == BlockAccess::PREFETCH_HIT;
+            miss |= access == BlockAccess::MISS;
+        }
     }
-    size_t remainingBytes = size - bufferOffset;
-    if(remainingBytes > 0){
-        // 将剩余部分复制到buffer中
-        memcpy(buffer + bufferOffset, readCache(blockIndex), remainingBytes);
+    if (m_readahead) {
+        updateReadahead(fh, file, offset, size, prefetchHit, miss);
     }
 }
 
-void CachedFileOperator::write(const char* data, size_t size) {
+void CachedFileOperator::pwrite(int fh, const char* data, size_t size, off_t offset) {
     /*
-    将data从当前文件所在位置开始写入size大小的数据
+    将data写入文件的offset处，共size大小
 
     dataOffset：待写入数据偏移量
     fileOffset：文件偏移量
     blockIndex：块索引
     blockOffset：块内偏移量
     */
-    if(m_fd == -1){
-        throw std::runtime_error("In write(): File not specified");
-    }
-    size_t dataOffset = 0, fileOffset = m_pos;
-    size_t blockIndex = fileOffset / BLOCK_SIZE;
-    size_t blockOffset = fileOffset % BLOCK_SIZE;
-    if(blockOffset != 0){
-        // 把数据写入到第一个块中需要写到的地方
-        size_t firstBlockSize = std::min(size, BLOCK_SIZE - blockOffset);
-        readCache(blockIndex); // 确保缓存块没有左空缺
-        writeCache(blockIndex, data + dataOffset, firstBlockSize, blockOffset);
-        blockIndex++;
-        dataOffset += firstBlockSize;
-    }
-    while(dataOffset + BLOCK_SIZE <= size){
-        // 整块写入
-        writeCache(blockIndex, data + dataOffset, BLOCK_SIZE, 0);
-        blockIndex++;
-        dataOffset += BLOCK_SIZE;
-    }
-    ssize_t remainingBytes = size - dataOffset;
-    if(remainingBytes > 0){
-        // 写入剩余部分
-        writeCache(blockIndex, data + dataOffset, remainingBytes, 0);
-    }
-}
-
-
-void CachedFileOperator::writeCache(size_t blockIndex, const char* dataBlock, size_t dataSize, size_t blockOffset) {
-    size_t offset;
-    auto it = m_cache.find(blockIndex);
-    
-    // 如果缓存中已有对应的块, 则直接修改缓存
-    if (it != m_cache.end()) {
-        offset = it->second.cacheBufferOffset;
-        it->second.blockValidSize = std::max(it->second.blockValidSize, blockOffset + dataSize);
-        memcpy(p_cacheBuffer.get() + offset + blockOffset, dataBlock, dataSize);
-
-        // 更新访问顺序
-        m_accessOrder.erase(it->second.accessOrderIterator); // 移除旧的访问顺序
-        it->second.accessOrderIterator = m_accessOrder.insert(m_accessOrder.begin(), blockIndex); // 插入到头部
+    FileInfo& file = getFile(fh, "pwrite");
+    m_trace.record(TRACE_WRITE, fh, offset, size);
+    writeRange(fh, file, data, size, offset);
+}
+
+void CachedFileOperator::writeRange(int fh, FileInfo& file, const char* data, size_t size, off_t offset) {
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_WRITE);
+    if (file.mapped) {
+        file.mapped->write(data, size, offset);
         return;
     }
-    
-    // 如果缓存没有对应的块
-    if (m_cache.size() >= CACHE_MAX_BLOCK) { // 如果缓存已满，移除最久未使用的块
-        size_t oldestBlock = m_accessOrder.back(); // 获取最旧的块索引
-        offset = m_cache[oldestBlock].cacheBufferOffset;
-        lseek(offset, SEEK_SET);
-        ::write(m_fd, p_cacheBuffer.get() + offset, m_cache[oldestBlock].blockValidSize);
-        
-        m_cache.erase(oldestBlock); // 从缓存中移除该块
-        m_accessOrder.pop_back(); // 更新访问顺序，移除最旧的块
-    } else { // 如果是缓存未满，计算偏移量
-        offset = (m_cache.size() * BLOCK_SIZE); 
-    }
-
-    // 将新数据放入缓存
-    if (blockOffset != 0) {
-        readCache(blockIndex); // 填满左空缺
-    }
-    
-    memcpy(p_cacheBuffer.get() + offset + blockOffset, dataBlock, dataSize);
-    
-    // 更新缓存映射和访问顺序
-    BlockInfo newBlockInfo;
-    newBlockInfo.cacheBufferOffset = offset;
-    newBlockInfo.blockValidSize = blockOffset + dataSize;
-    newBlockInfo.accessOrderIterator = m_accessOrder.insert(m_accessOrder.begin(), blockIndex); // 插入到头部
-    
-    m_cache[blockIndex] = newBlockInfo; // 添加到缓存中
-}
-
-char* CachedFileOperator::readCache(size_t blockIndex) {
-    auto it = m_cache.find(blockIndex);
-    
-    if (it != m_cache.end()) { // 如果已在缓存中，更新块的值
-        size_t offset = it->second.cacheBufferOffset;
-        
-        if (it->second.blockValidSize < BLOCK_SIZE) {
-            ssize_t readBytes = ::read(m_fd, p_cacheBuffer.get() + offset, BLOCK_SIZE);
-            if (readBytes == -1) {
-                throw std::runtime_error("Failed to read");
-            }
-            if (readBytes != 0)
-                it->second.blockValidSize = readBytes;
-        }
-
-        // 更新访问顺序
-        m_accessOrder.erase(it->second.accessOrderIterator); // 移除旧的访问顺序
-        it->second.accessOrderIterator = m_accessOrder.insert(m_accessOrder.begin(), blockIndex); // 插入到头部
-        
-        return p_cacheBuffer.get() + offset; // 返回缓存数据
-    } 
-    // 如果不在缓存中，从文件读取一整块
-    std::unique_ptr<char[]> buf(new char[BLOCK_SIZE]); 
-    ssize_t readBytes = ::read(m_fd, buf.get(), BLOCK_SIZE);
-    
-    if (readBytes == -1) {
-        throw std::runtime_error("Failed to read");
-    }
-    
-    writeCache(blockIndex, buf.get(), readBytes, 0); // 将读取的数据写入缓存中
-    return p_cacheBuffer.get() + m_cache[blockIndex].cacheBufferOffset;
-}
\ No newline at end of file
+    throttleWriter();
+    std::shared_lock<std::shared_mutex> journalLock;
+    uint64_t lsn = 0;
+    if (file.journal) { // 先记日志再写缓存，检查点不会截断已写入缓存但未写回的记录
+        journalLock = std::shared_lock<std::shared_mutex>(file.journalMutex);
+        lsn = file.journal->append(offset, data, size);
+        m_stats.add(STAT_JOURNAL_BYTES, size);
+    }
+
+    // 先更新文件大小，保证任何时刻缓存中的数据都在文件大小之内（O_DIRECT写回后按文件大小截断）
+    size_t end = offset + size;
+    size_t oldSize = file.fileSize.load();
+    while (oldSize < end && !file.fileSize.compare_exchange_weak(oldSize, end)) {
+    }
+
+    size_t dataOffset = 0;
+    while(dataOffset < size){
+        size_t fileOffset = offset + dataOffset;
+        size_t blockIndex = fileOffset / m_blockSize;
+        size_t blockOffset = fileOffset % m_blockSize;
+        size_t pieceSize = std::min(size - dataOffset, m_blockSize - blockOffset); // 本块内需要写入的部分
+        size_t key = makeBlockKey(fh, blockIndex);
+        CacheShard& shard = shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        writeCache(lock, shard, key, data + dataOffset, pieceSize, blockOffset);
+        dataOffset += pieceSize;
+    }
+
+    if (file.journal) { // 日志落盘后写入才算完成；并发的写入在此成组提交
+        m_stats.add(STAT_JOURNAL_SYNCS, file.journal->commit(lsn));
+        journalLock.unlock();
+        if (file.journal->size() >= m_journalCheckpointSize) {
+            checkpoint(fh, file, m_journalCheckpointSize);
+        }
+    }
+}
+
+void CachedFileOperator::readv(int fh, const struct iovec* iov, int iovcnt) {
+    FileInfo& file = getFile(fh, "readv");
+    std::vector<IoSegment> segments(iovcnt);
+    off_t offset = file.pos;
+    for (int i = 0; i < iovcnt; i++) { // 各缓冲区在文件中首尾相接
+        segments[i] = {offset, iov[i].iov_base, iov[i].iov_len};
+        offset += iov[i].iov_len;
+    }
+    preadv(fh, segments.data(), segments.size());
+    file.pos = offset;
+}
+
+void CachedFileOperator::writev(int fh, const struct iovec* iov, int iovcnt) {
+    FileInfo& file = getFile(fh, "writev");
+    std::vector<IoSegment> segments(iovcnt);
+    off_t offset = file.pos;
+    for (int i = 0; i < iovcnt; i++) {
+        segments[i] = {offset, iov[i].iov_base, iov[i].iov_len};
+        offset += iov[i].iov_len;
+    }
+    pwritev(fh, segments.data(), segments.size());
+    file.pos = offset;
+}
+
+void CachedFileOperator::splitSegments(const IoSegment* segments, size_t count, std::vector<SegmentPiece>& pieces) {
+    pieces.clear();
+    for (size_t i = 0; i < count; i++) {
+        size_t done = 0;
+        while (done < segments[i].length) {
+            size_t fileOffset = segments[i].offset + done;
+            size_t blockOffset = fileOffset % m_blockSize;
+            size_t pieceSize = std::min(segments[i].length - done, m_blockSize - blockOffset);
+            pieces.push_back({fileOffset / m_blockSize, blockOffset, static_cast<char*>(segments[i].buffer) + done, pieceSize});
+            done += pieceSize;
+        }
+    }
+    // 稳定排序：同一块的各部分相邻，重叠的写入仍按段的顺序覆盖
+    std::stable_sort(pieces.begin(), pieces.end(), [](const SegmentPiece& a, const SegmentPiece& b) {
+        return a.blockIndex < b.blockIndex;
+    });
+}
+
+// 同一块的各部分[blockOffset, blockOffset + length)是否覆盖了整块
+static bool coversBlock(const SegmentPiece* begin, const SegmentPiece* end, size_t blockSize) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (const SegmentPiece* p = begin; p != end; p++) {
+        ranges.push_back({p->blockOffset, p->blockOffset + p->length});
+    }
+    std::sort(ranges.begin(), ranges.end());
+    size_t covered = 0;
+    for (const std::pair<size_t, size_t>& range : ranges) {
+        if (range.first > covered) return false;
+        covered = std::max(covered, range.second);
+    }
+    return covered >= blockSize;
+}
+
+void CachedFileOperator::preadv(int fh, const IoSegment* segments, size_t count) {
+    /*
+    按各段的偏移量读取。先把所有段按块切分并排序，每个块只加锁、查找（缺失时读入）和提升一次，
+    再把该块中的各部分复制到对应的缓冲区。缺失的块逐块读入，不像pread那样成批提交。
+    */
+    FileInfo& file = getFile(fh, "preadv");
+    for (size_t i = 0; i < count; i++) {
+        m_trace.record(TRACE_READ, fh, segments[i].offset, segments[i].length);
+    }
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_READ);
+    if (file.mapped) {
+        for (size_t i = 0; i < count; i++) {
+            file.mapped->read(static_cast<char*>(segments[i].buffer), segments[i].length, segments[i].offset);
+        }
+        return;
+    }
+    std::vector<SegmentPiece> pieces;
+    splitSegments(segments, count, pieces);
+    if (pieces.empty()) return;
+
+    bool prefetchHit = false, miss = false;
+    size_t fileSize = file.fileSize.load();
+    for (size_t first = 0; first < pieces.size();) {
+        size_t last = first + 1; // 本块的各部分为pieces[first, last)
+        while (last < pieces.size() && pieces[last].blockIndex == pieces[first].blockIndex) last++;
+        if (pieces[first].blockIndex * m_blockSize >= fileSize) { // 整块在文件末尾之后
+            for (size_t i = first; i < last; i++) {
+                memset(pieces[i].buffer, 0, pieces[i].length);
+                m_stats.add(STAT_BYTES_PAST_EOF, pieces[i].length);
+            }
+            first = last;
+            continue;
+        }
+        size_t key = makeBlockKey(fh, pieces[first].blockIndex);
+        CacheShard& shard = shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        BlockAccess access;
+        BlockInfo& info = loadBlock(lock, shard, key, true, &access);
+        prefetchHit |= access == BlockAccess::PREFETCH_HIT;
+        miss |= access == BlockAccess::MISS;
+        for (size_t i = first; i < last; i++) {
+            memcpy(pieces[i].buffer, p_cacheBuffer.get() + info.cacheBufferOffset + pieces[i].blockOffset, pieces[i].length);
+        }
+        first = last;
+    }
+    if (m_readahead) { // 把整次调用看作对所涉及范围的一次访问
+        size_t begin = pieces.front().blockIndex * m_blockSize;
+        size_t end = (pieces.back().blockIndex + 1) * m_blockSize;
+        updateReadahead(fh, file, begin, end - begin, prefetchHit, miss);
+    }
+}
+
+void CachedFileOperator::pwritev(int fh, const IoSegment* segments, size_t count) {
+    /*
+    按各段的偏移量写入。限速、日志提交和文件大小更新每次调用只做一次；
+    每个块只加锁、查找和提升一次，各部分的并集覆盖整块时无需先读入该块，最后只标记一次脏块。
+    */
+    FileInfo& file = getFile(fh, "pwritev");
+    for (size_t i = 0; i < count; i++) {
+        m_trace.record(TRACE_WRITE, fh, segments[i].offset, segments[i].length);
+    }
+    LatencyTimer timer(m_latencyHistograms ? &m_stats : nullptr, LATENCY_WRITE);
+    if (file.mapped) {
+        for (size_t i = 0; i < count; i++) {
+            file.mapped->write(static_cast<const char*>(segments[i].buffer), segments[i].length, segments[i].offset);
+        }
+        return;
+    }
+    std::vector<SegmentPiece> pieces;
+    splitSegments(segments, count, pieces);
+    if (pieces.empty()) return;
+
+    throttleWriter();
+    std::shared_lock<std::shared_mutex> journalLock;
+    uint64_t lsn = 0;
+    if (file.journal) { // 每段一条记录，重放时按顺序应用，重叠部分与缓存中的结果一致
+        journalLock = std::shared_lock<std::shared_mutex>(file.journalMutex);
+        for (size_t i = 0; i < count; i++) {
+            if (segments[i].length == 0) continue;
+            lsn = file.journal->append(segments[i].offset, static_cast<const char*>(segments[i].buffer), segments[i].length);
+            m_stats.add(STAT_JOURNAL_BYTES, segments[i].length);
+        }
+    }
+
+    size_t end = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].length != 0) end = std::max<size_t>(end, segments[i].offset + segments[i].length);
+    }
+    size_t oldSize = file.fileSize.load();
+    while (oldSize < end && !file.fileSize.compare_exchange_weak(oldSize, end)) {
+    }
+
+    for (size_t first = 0; first < pieces.size();) {
+        size_t last = first + 1;
+        while (last < pieces.size() && pieces[last].blockIndex == pieces[first].blockIndex) last++;
+        size_t key = makeBlockKey(fh, pieces[first].blockIndex);
+        CacheShard& shard = shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        bool fill = !coversBlock(&pieces[first], &pieces[first] + (last - first), m_blockSize);
+        BlockInfo& info = loadBlock(lock, shard, key, fill);
+        size_t blockStart = pieces[first].blockIndex * m_blockSize;
+        for (size_t i = first; i < last; i++) {
+            memcpy(p_cacheBuffer.get() + info.cacheBufferOffset + pieces[i].blockOffset, pieces[i].buffer, pieces[i].length);
+            info.blockValidSize = std::max(info.blockValidSize, pieces[i].blockOffset + pieces[i].length);
+            markStored(file, blockStart + pieces[i].blockOffset, blockStart + pieces[i].blockOffset + pieces[i].length);
+        }
+        markDirty(shard, &info - shard.slots.data());
+        first = last;
+    }
+
+    if (file.journal) {
+        m_stats.add(STAT_JOURNAL_SYNCS, file.journal->commit(lsn));
+        journalLock.unlock();
+        if (file.journal->size() >= m_journalCheckpointSize) {
+            checkpoint(fh, file, m_journalCheckpointSize);
+        }
+    }
+}
+
+void CachedFileOperator::punchHole(int fh, off_t offset, size_t length) {
+    FileInfo& file = getFile(fh, "punchHole");
+    if (file.mapped) {
+        throw std::runtime_error("In punchHole(): Not supported for memory-mapped file: " + file.fileName);
+    }
+    if (length == 0) return;
+    if (file.journal) { // 检查点清空日志并落盘后才打洞，日志中较早的写入不会在崩溃后重放到空洞里
+        checkpoint(fh, file, 0);
+    }
+    std::lock_guard<std::mutex> writebackLock(m_writebackRoundMutex); // 后台写回不会在打洞之后写入旧数据
+    size_t begin = offset, end = offset + length;
+    discardRange(fh, begin, end);
+    if (fallocate(file.fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == -1) {
+        throw std::runtime_error("Failed to punch hole in file: " + file.fileName + ": " + strerror(errno));
+    }
+    addHole(file, begin, end); // 先记录空洞，此后的写入会把它移除
+    discardRange(fh, begin, end); // 打洞期间读入或写入缓存的块可能仍带有旧数据
+}
+
+void CachedFileOperator::preallocate(int fh, off_t offset, size_t length, bool keepSize) {
+    FileInfo& file = getFile(fh, "preallocate");
+    if (file.mapped) {
+        throw std::runtime_error("In preallocate(): Not supported for memory-mapped file: " + file.fileName);
+    }
+    if (length == 0) return;
+    if (fallocate(file.fd, keepSize ? FALLOC_FL_KEEP_SIZE : 0, offset, length) == -1) {
+        throw std::runtime_error("Failed to preallocate file: " + file.fileName + ": " + strerror(errno));
+    }
+    if (!keepSize) { // 新分配的部分读到0，不改变storedSize
+        size_t end = offset + length;
+        size_t oldSize = file.fileSize.load();
+        while (oldSize < end && !file.fileSize.compare_exchange_weak(oldSize, end)) {
+        }
+    }
+}
+
+// 执行一个异步请求并调用其完成回调，操作抛出的异常交给回调
+static void runAsyncRequest(AsyncRequest& request) {
+    std::exception_ptr error;
+    try {
+        request.work();
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    request.done(error);
+}
+
+AsyncCallback CachedFileOperator::promiseCallback(std::shared_ptr<std::promise<void>> promise) {
+    return [promise](std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value();
+        }
+    };
+}
+
+std::future<void> CachedFileOperator::readAsync(int fh, char* buffer, size_t size, off_t offset) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    readAsync(fh, buffer, size, offset, promiseCallback(promise));
+    return future;
+}
+
+std::future<void> CachedFileOperator::writeAsync(int fh, const char* data, size_t size, off_t offset) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    writeAsync(fh, data, size, offset, promiseCallback(promise));
+    return future;
+}
+
+std::future<void> CachedFileOperator::flushAsync(int fh) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    flushAsync(fh, promiseCallback(promise));
+    return future;
+}
+
+void CachedFileOperator::readAsync(int fh, char* buffer, size_t size, off_t offset, AsyncCallback done) {
+    FileInfo& file = getFile(fh, "readAsync");
+    if (size > 0) m_trace.record(TRACE_READ, fh, offset, size);
+    size_t end = offset + size;
+    // 映射文件的读取可能缺页，也交给工作线程
+    size_t reached = file.mapped ? offset : readResident(fh, file, buffer, size, offset);
+    if (reached == end) {
+        m_stats.add(STAT_ASYNC_INLINE);
+        done(nullptr);
+        return;
+    }
+    submitAsync([this, fh, &file, buffer, offset, reached, end]() {
+        readRange(fh, file, buffer + (reached - offset), end - reached, reached);
+    }, std::move(done));
+}
+
+void CachedFileOperator::writeAsync(int fh, const char* data, size_t size, off_t offset, AsyncCallback done) {
+    FileInfo& file = getFile(fh, "writeAsync");
+    m_trace.record(TRACE_WRITE, fh, offset, size);
+    size_t end = offset + size;
+    size_t reached = file.mapped ? offset : writeResident(fh, file, data, size, offset);
+    if (reached == end) {
+        m_stats.add(STAT_ASYNC_INLINE);
+        done(nullptr);
+        return;
+    }
+    submitAsync([this, fh, &file, data, offset, reached, end]() {
+        writeRange(fh, file, data + (reached - offset), end - reached, reached);
+    }, std::move(done));
+}
+
+void CachedFileOperator::flushAsync(int fh, AsyncCallback done) {
+    getFile(fh, "flushAsync");
+    submitAsync([this, fh]() { flush(fh); }, std::move(done));
+}
+
+size_t CachedFileOperator::readResident(int fh, FileInfo& file, char* buffer, size_t size, off_t offset) {
+    size_t end = offset + size;
+    if (end > file.fileSize.load()) return offset; // 文件末尾之后的部分由readRange()填0
+    bool prefetchHit = false;
+    size_t fileOffset = offset;
+    while (fileOffset < end) {
+        size_t blockIndex = fileOffset / m_blockSize;
+        size_t blockOffset = fileOffset % m_blockSize;
+        size_t pieceSize = std::min(end - fileOffset, m_blockSize - blockOffset);
+        size_t key = makeBlockKey(fh, blockIndex);
+        CacheShard& shard = shardOf(key);
+        // 分片的锁可能正被淘汰时的写回占用，拿不到就交给工作线程，调用线程不等待I/O
+        std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) break;
+        size_t slot = shard.index.find(key);
+        if (slot == BlockTable::NOT_FOUND || shard.slots[slot].loading) break;
+        prefetchHit |= recordHit(shard, slot) == BlockAccess::PREFETCH_HIT;
+        memcpy(buffer + (fileOffset - offset), p_cacheBuffer.get() + shard.slots[slot].cacheBufferOffset + blockOffset, pieceSize);
+        fileOffset += pieceSize;
+    }
+    if (m_readahead && fileOffset > static_cast<size_t>(offset)) { // 其余部分由readRange()继续检测
+        updateReadahead(fh, file, offset, fileOffset - offset, prefetchHit, false);
+    }
+    return fileOffset;
+}
+
+size_t CachedFileOperator::writeResident(int fh, FileInfo& file, const char* data, size_t size, off_t offset) {
+    // 日志文件要等日志落盘，脏块过多时要等后台写回，都交给工作线程
+    if (file.journal || m_dirtyBlocks.load() >= m_dirtyLimit.load()) return offset;
+    size_t end = offset + size;
+    size_t oldSize = file.fileSize.load();
+    while (oldSize < end && !file.fileSize.compare_exchange_weak(oldSize, end)) {
+    }
+    size_t fileOffset = offset;
+    while (fileOffset < end) {
+        size_t blockIndex = fileOffset / m_blockSize;
+        size_t blockOffset = fileOffset % m_blockSize;
+        size_t pieceSize = std::min(end - fileOffset, m_blockSize - blockOffset);
+        size_t key = makeBlockKey(fh, blockIndex);
+        CacheShard& shard = shardOf(key);
+        std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) break;
+        size_t slot = shard.index.find(key);
+        if (slot == BlockTable::NOT_FOUND || shard.slots[slot].loading) break;
+        recordHit(shard, slot);
+        storeData(shard, slot, data + (fileOffset - offset), pieceSize, blockOffset);
+        fileOffset += pieceSize;
+    }
+    return fileOffset;
+}
+
+void CachedFileOperator::submitAsync(std::function<void()> work, AsyncCallback done) {
+    m_stats.add(STAT_ASYNC_QUEUED);
+    AsyncRequest request{std::move(work), std::move(done)};
+    if (m_asyncThreads.empty()) { // 没有工作线程时同步完成
+        runAsyncRequest(request);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_asyncQueue.push_back(std::move(request));
+    }
+    m_asyncCv.notify_one();
+}
+
+void CachedFileOperator::asyncRun() {
+    std::unique_lock<std::mutex> lock(m_asyncMutex);
+    while (true) {
+        m_asyncCv.wait(lock, [this]() { return m_asyncStop || !m_asyncQueue.empty(); });
+        if (m_asyncQueue.empty()) return; // 停止时先完成队列中剩余的请求
+        AsyncRequest request = std::move(m_asyncQueue.front());
+        m_asyncQueue.pop_front();
+        lock.unlock();
+        runAsyncRequest(request);
+        lock.lock();
+    }
+}
+
+ssize_t CachedFileOperator::zeroBlockSize(FileInfo& file, size_t blockIndex) {
+    size_t start = blockIndex * m_blockSize;
+    size_t stored = file.storedSize.load();
+    if (start >= stored) return 0;
+    if (!file.hasHoles.load()) return -1;
+    size_t end = std::min(start + m_blockSize, stored);
+    std::lock_guard<std::mutex> lock(file.holesMutex);
+    auto it = file.holes.upper_bound(start); // 空洞互不相邻，整块只可能落在起点不大于start的最后一个空洞中
+    if (it == file.holes.begin()) return -1;
+    --it;
+    return it->second >= end ? static_cast<ssize_t>(end - start) : -1;
+}
+
+void CachedFileOperator::markStored(FileInfo& file, size_t begin, size_t end) {
+    size_t stored = file.storedSize.load();
+    while (stored < end && !file.storedSize.compare_exchange_weak(stored, end)) {
+    }
+    if (!file.hasHoles.load()) return;
+    std::lock_guard<std::mutex> lock(file.holesMutex);
+    auto it = file.holes.lower_bound(begin);
+    if (it != file.holes.begin() && std::prev(it)->second > begin) --it;
+    while (it != file.holes.end() && it->first < end) { // 与[begin, end)重叠的空洞只保留两侧剩余的部分
+        size_t holeBegin = it->first, holeEnd = it->second;
+        it = file.holes.erase(it);
+        if (holeBegin < begin) file.holes[holeBegin] = begin;
+        if (holeEnd > end) file.holes[end] = holeEnd;
+    }
+    file.hasHoles = !file.holes.empty();
+}
+
+void CachedFileOperator::addHole(FileInfo& file, size_t begin, size_t end) {
+    std::lock_guard<std::mutex> lock(file.holesMutex);
+    auto it = file.holes.upper_bound(begin);
+    if (it != file.holes.begin() && std::prev(it)->second >= begin) { // 与前一个空洞重叠或相邻
+        --it;
+        begin = it->first;
+    }
+    while (it != file.holes.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = file.holes.erase(it);
+    }
+    file.holes[begin] = end;
+    file.hasHoles = true;
+}
+
+void CachedFileOperator::discardRange(int fh, size_t begin, size_t end) {
+    // 处理一个块：二级缓存中的副本作废；整块在范围内且未被固定时移除，否则把范围内的部分清零（脏块写回时写入0）
+    auto discard = [&](CacheShard& shard, std::unique_lock<std::mutex>& lock, size_t key) {
+        if (shard.tier) shard.tier->erase(key);
+        size_t slot;
+        while ((slot = shard.index.find(key)) != BlockTable::NOT_FOUND && shard.slots[slot].loading) {
+            shard.loaded.wait(lock);
+        }
+        if (slot == BlockTable::NOT_FOUND) return;
+        BlockInfo& info = shard.slots[slot];
+        size_t blockStart = keyBlock(key) * m_blockSize;
+        size_t from = std::max(begin, blockStart) - blockStart;
+        size_t to = std::min(end, blockStart + m_blockSize) - blockStart;
+        if (from == 0 && to == m_blockSize && info.pins == 0) {
+            markClean(shard, slot);
+            shard.policy->onRemove(slot);
+            shard.index.erase(key);
+            shard.freeSlots.push_back(slot);
+            shard.loaded.notify_all();
+        } else {
+            memset(p_cacheBuffer.get() + info.cacheBufferOffset + from, 0, to - from);
+        }
+    };
+
+    size_t firstBlock = begin / m_blockSize;
+    size_t endBlock = (end + m_blockSize - 1) / m_blockSize;
+    if (endBlock - firstBlock <= m_maxSlots) { // 范围不大时逐块查找
+        for (size_t blockIndex = firstBlock; blockIndex < endBlock; blockIndex++) {
+            size_t key = makeBlockKey(fh, blockIndex);
+            CacheShard& shard = shardOf(key);
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            discard(shard, lock, key);
+        }
+        return;
+    }
+    for (size_t i = 0; i < m_numShards; i++) { // 范围比整个缓存还大时遍历各分片中该文件的块
+        CacheShard& shard = m_shards[i];
+        auto inRange = [&](size_t key) {
+            return keyFile(key) == fh && keyBlock(key) >= firstBlock && keyBlock(key) < endBlock;
+        };
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (shard.tier) shard.tier->eraseIf(inRange);
+        std::vector<size_t> keys;
+        shard.index.forEach([&](size_t key, size_t) {
+            if (inRange(key)) keys.push_back(key);
+        });
+        for (size_t key : keys) {
+            discard(shard, lock, key);
+        }
+    }
+}
+
+size_t CachedFileOperator::reserveSlot(CacheShard& shard, size_t key) {
+    size_t slot;
+    if (shard.freeSlots.empty()) { // 如果分片已满，由淘汰策略选出一个块（可能属于其他文件）
+        slot = shard.policy->selectVictim();
+        BlockInfo& victim = shard.slots[slot];
+        try {
+            if (victim.dirty) {
+                m_stats.add(STAT_EVICTION_WRITE_BACKS);
+            }
+            writeBack(shard, slot); // 只有脏块需要写回
+        }
+        catch (const std::runtime_error&) {
+            shard.policy->onInsert(slot, victim.key); // 写回失败，块留在缓存中
+            throw;
+        }
+        if (victim.prefetched) {
+            m_stats.add(STAT_READAHEAD_WASTED); // 预读的块未被访问就被淘汰
+        }
+        if (shard.tier && victim.blockValidSize > 0) { // 已写回，作为干净块压缩存入二级缓存
+            size_t compressedSize = shard.tier->store(victim.key, p_cacheBuffer.get() + victim.cacheBufferOffset, victim.blockValidSize);
+            if (compressedSize > 0) {
+                m_stats.add(STAT_TIER_STORES);
+                m_stats.add(STAT_TIER_BYTES_IN, victim.blockValidSize);
+                m_stats.add(STAT_TIER_BYTES_OUT, compressedSize);
+            } else {
+                m_stats.add(STAT_TIER_BYPASSES);
+            }
+        }
+        shard.index.erase(victim.key); // 从缓存中移除该块
+        m_stats.add(STAT_EVICTIONS);
+    } else {
+        slot = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+    }
+
+    BlockInfo& info = shard.slots[slot];
+    info.key = key;
+    info.blockValidSize = 0;
+    info.dirty = false;
+    info.loading = false;
+    info.prefetched = false;
+    info.pins = 0;
+    info.writingBack = false;
+    shard.index.insert(key, slot);
+    return slot;
+}
+
+ssize_t CachedFileOperator::fillSlot(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t slot) {
+    // 读文件时释放分片锁，其他线程可以继续访问本分片的其他块
+    std::vector<BlockFill> fills = {{&shard, slot, keyBlock(shard.slots[slot].key), -1}};
+    FileInfo& file = m_files[keyFile(shard.slots[slot].key)];
+    beginFill(shard, slot);
+    lock.unlock();
+    try {
+        readBlocks(file, fills);
+    }
+    catch (const std::runtime_error&) { // I/O引擎出错，释放该槽后重新持锁，与正常返回时一致
+        abortFills(fills);
+        lock.lock();
+        throw;
+    }
+    lock.lock();
+    finishFill(shard, slot, fills[0].result);
+    return fills[0].result;
+}
+
+void CachedFileOperator::beginFill(CacheShard& shard, size_t slot) {
+    shard.slots[slot].loading = true;
+    shard.loadingCount++;
+}
+
+void CachedFileOperator::finishFill(CacheShard& shard, size_t slot, ssize_t readBytes) {
+    BlockInfo& info = shard.slots[slot];
+    info.loading = false;
+    shard.loadingCount--;
+    if (readBytes == -1) { // 读取失败，释放该槽
+        shard.index.erase(info.key);
+        shard.freeSlots.push_back(slot);
+    } else {
+        memset(p_cacheBuffer.get() + info.cacheBufferOffset + readBytes, 0, m_blockSize - readBytes); // 文件末尾之后的部分填0
+        info.blockValidSize = readBytes;
+    }
+    shard.loaded.notify_all();
+}
+
+void CachedFileOperator::abortFills(std::vector<BlockFill>& fills) {
+    for (BlockFill& fill : fills) {
+        std::lock_guard<std::mutex> lock(fill.shard->mutex);
+        finishFill(*fill.shard, fill.slot, -1);
+    }
+    fills.clear();
+}
+
+void CachedFileOperator::readBlocks(FileInfo& file, std::vector<BlockFill>& fills) {
+    if (fills.empty()) return;
+    // 先在二级缓存中查找，命中的块解压到槽中；已知全为0的块直接填0；其余的块从文件读入
+    std::vector<size_t> pending; // 需要读文件的fills下标
+    for (size_t i = 0; i < fills.size(); i++) {
+        CacheShard& shard = *fills[i].shard;
+        BlockInfo& info = shard.slots[fills[i].slot];
+        if (shard.tier) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            fills[i].result = shard.tier->load(info.key, p_cacheBuffer.get() + info.cacheBufferOffset);
+            if (fills[i].result != -1) {
+                m_stats.add(STAT_TIER_HITS);
+                continue;
+            }
+        }
+        fills[i].result = zeroBlockSize(file, fills[i].blockIndex);
+        if (fills[i].result != -1) {
+            memset(p_cacheBuffer.get() + info.cacheBufferOffset, 0, fills[i].result); // 其余部分由finishFill()填0
+            m_stats.add(STAT_ZERO_FILLS);
+            continue;
+        }
+        pending.push_back(i);
+    }
+    if (pending.empty()) return;
+
+    // 槽地址、块偏移量和块大小都满足O_DIRECT的对齐要求
+    std::vector<struct iovec> iov(pending.size());
+    std::vector<IoRequest> requests(pending.size());
+    for (size_t i = 0; i < pending.size(); i++) {
+        const BlockFill& fill = fills[pending[i]];
+        iov[i] = {p_cacheBuffer.get() + fill.shard->slots[fill.slot].cacheBufferOffset, m_blockSize};
+        requests[i] = {file.fd, false, &iov[i], 1, static_cast<off_t>(fill.blockIndex * m_blockSize), 0, 0};
+    }
+    m_stats.add(STAT_READ_CALLS, m_io->submit(requests.data(), requests.size()));
+
+    bool rejected = false;
+    for (const IoRequest& request : requests) {
+        rejected |= request.result == -1 && request.error == EINVAL;
+    }
+    if (rejected && file.direct) { // 文件系统拒绝O_DIRECT读取，退回普通读取后重新提交
+        try {
+            disableDirect(file);
+            m_stats.add(STAT_READ_CALLS, m_io->submit(requests.data(), requests.size()));
+        }
+        catch (const std::runtime_error&) {
+        }
+    }
+    for (size_t i = 0; i < pending.size(); i++) {
+        BlockFill& fill = fills[pending[i]];
+        fill.result = requests[i].result;
+        if (fill.result > 0) {
+            m_stats.add(STAT_BYTES_READ, fill.result);
+        }
+    }
+}
+
+BlockInfo& CachedFileOperator::loadBlock(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, bool fill, BlockAccess* access) {
+    while (true) {
+        size_t slot = shard.index.find(key);
+        if (slot != BlockTable::NOT_FOUND) {
+            BlockInfo& info = shard.slots[slot];
+            if (info.loading) { // 其他线程（或预读线程）正在读入该块，等待其完成
+                shard.loaded.wait(lock);
+                continue;
+            }
+            BlockAccess hit = recordHit(shard, slot);
+            if (access) *access = hit;
+            return info;
+        }
+        if (shardExhausted(shard)) {
+            if (shard.loadingCount == 0 && shard.writebackPinned == 0) {
+                throw std::runtime_error("All cache blocks in shard are pinned");
+            }
+            shard.loaded.wait(lock); // 等待正在读入的块完成或后台写回解除保护后再淘汰
+            continue;
+        }
+        break;
+    }
+
+    // 如果缓存没有对应的块，先在本分片内分配缓存槽
+    m_stats.add(STAT_MISSES);
+    if (access) *access = BlockAccess::MISS;
+    shard.policy->onMiss(key);
+    size_t slot = reserveSlot(shard, key);
+    BlockInfo& info = shard.slots[slot];
+    if (fill) { // 从块在文件中的位置读取一整块
+        if (fillSlot(lock, shard, slot) == -1) {
+            throw std::runtime_error("Failed to read");
+        }
+    } else {
+        memset(p_cacheBuffer.get() + info.cacheBufferOffset, 0, m_blockSize);
+        if (shard.tier) shard.tier->erase(key); // 块将被整块覆盖，二级缓存中的旧内容作废
+    }
+    shard.policy->onInsert(slot, key); // 交给淘汰策略管理
+    return info;
+}
+
+void CachedFileOperator::writeCache(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, const char* dataBlock, size_t dataSize, size_t blockOffset) {
+    // 整块覆盖时无需先读文件，否则先读入整块以保留块内其余数据
+    BlockInfo& info = loadBlock(lock, shard, key, dataSize != m_blockSize);
+    storeData(shard, &info - shard.slots.data(), dataBlock, dataSize, blockOffset);
+}
+
+void CachedFileOperator::storeData(CacheShard& shard, size_t slot, const char* dataBlock, size_t dataSize, size_t blockOffset) {
+    BlockInfo& info = shard.slots[slot];
+    memcpy(p_cacheBuffer.get() + info.cacheBufferOffset + blockOffset, dataBlock, dataSize);
+    info.blockValidSize = std::max(info.blockValidSize, blockOffset + dataSize);
+    size_t blockStart = keyBlock(info.key) * m_blockSize;
+    markStored(m_files[keyFile(info.key)], blockStart + blockOffset, blockStart + blockOffset + dataSize);
+    markDirty(shard, slot);
+}
+
+CachedFileOperator::BlockAccess CachedFileOperator::readCache(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, char* buffer, size_t size, size_t blockOffset) {
+    BlockAccess access;
+    BlockInfo& info = loadBlock(lock, shard, key, true, &access);
+    memcpy(buffer, p_cacheBuffer.get() + info.cacheBufferOffset + blockOffset, size); // 复制缓存数据
+    return access;
+}
+
+CachedFileOperator::BlockAccess CachedFileOperator::recordHit(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    m_stats.add(STAT_HITS);
+    if (info.prefetched) { // 预读的块第一次被访问，视作装入，不再通知淘汰策略
+        info.prefetched = false;
+        m_stats.add(STAT_READAHEAD_HITS);
+        return BlockAccess::PREFETCH_HIT;
+    }
+    if (info.pins == 0) { // 被固定的块不在淘汰策略中
+        shard.policy->onAccess(slot);
+    }
+    return BlockAccess::HIT;
+}
+
+bool CachedFileOperator::shardExhausted(CacheShard& shard) {
+    // 正在读入和被固定的块不在淘汰策略中，被后台写回保护的块在策略中但不能淘汰
+    return shard.freeSlots.empty() && shard.loadingCount + shard.pinnedCount + shard.writebackPinned == shard.capacity;
+}
+
+void CachedFileOperator::pinSlot(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    if (info.pins++ == 0) { // 第一次固定时移出淘汰策略
+        shard.policy->onRemove(slot);
+        shard.pinnedCount++;
+        if (info.writingBack) shard.writebackPinned--; // 改由pinnedCount计数
+    }
+}
+
+void CachedFileOperator::unpinSlot(CacheShard& shard, size_t slot) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    BlockInfo& info = shard.slots[slot];
+    if (--info.pins == 0) { // 最后一个视图释放后重新交给淘汰策略
+        shard.pinnedCount--;
+        if (info.writingBack) shard.writebackPinned++;
+        shard.policy->onInsert(slot, info.key);
+        shard.loaded.notify_all();
+    }
+}
+
+void CachedFileOperator::pinForWriteback(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    info.writingBack = true;
+    shard.policy->setPinned(slot, true);
+    if (info.pins == 0) shard.writebackPinned++;
+}
+
+void CachedFileOperator::unpinForWriteback(CacheShard& shard, size_t slot) {
+    BlockInfo& info = shard.slots[slot];
+    info.writingBack = false;
+    shard.policy->setPinned(slot, false);
+    if (info.pins == 0) {
+        shard.writebackPinned--;
+        shard.loaded.notify_all(); // 等待淘汰的线程可以选它了
+    }
+}
+
+BlockView CachedFileOperator::pin(int fh, off_t offset, size_t size) {
+    if (getFile(fh, "pin").mapped) { // 扩展文件时映射区可能移动，视图无法保持有效
+        throw std::runtime_error("In pin(): Memory-mapped file has no cache blocks: " + m_files[fh].fileName);
+    }
+    size_t blockIndex = offset / m_blockSize;
+    size_t blockOffset = offset % m_blockSize;
+    size_t key = makeBlockKey(fh, blockIndex);
+    CacheShard& shard = shardOf(key);
+    BlockView view;
+    BlockAccess access;
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        BlockInfo& info = loadBlock(lock, shard, key, true, &access);
+        size_t slot = &info - shard.slots.data();
+        pinSlot(shard, slot);
+        view.m_owner = this;
+        view.m_shard = &shard;
+        view.m_slot = slot;
+        view.m_data = p_cacheBuffer.get() + info.cacheBufferOffset + blockOffset;
+        view.m_size = std::min(size, m_blockSize - blockOffset);
+        view.m_offset = offset;
+    }
+    if (m_readahead && view.m_size > 0) {
+        updateReadahead(fh, m_files[fh], offset, view.m_size, access == BlockAccess::PREFETCH_HIT, access == BlockAccess::MISS);
+    }
+    return view;
+}
+
+BlockRange CachedFileOperator::views(int fh, off_t offset, size_t size) {
+    getFile(fh, "views");
+    return BlockRange(this, fh, offset, offset + size);
+}
+
+void CachedFileOperator::updateReadahead(int fh, FileInfo& file, off_t offset, size_t size, bool prefetchHit, bool miss) {
+    size_t firstBlock = offset / m_blockSize;
+    size_t lastBlock = (offset + size - 1) / m_blockSize;
+    std::lock_guard<std::mutex> lock(file.raMutex);
+
+    // 从上次读到的块（小粒度读取时可能还在同一块内）或其下一块开始读，视为顺序访问
+    bool sequential = firstBlock == file.raNextBlock || firstBlock + 1 == file.raNextBlock;
+    file.raNextBlock = lastBlock + 1;
+    if (!sequential) { // 随机访问：重置预读状态
+        file.raWindow = READAHEAD_MIN_WINDOW;
+        file.raScheduledEnd = 0;
+        return;
+    }
+
+    // 预读命中说明窗口足够，可以继续增大；顺序访问仍未命中说明预读跟不上或被淘汰，缩小窗口
+    if (prefetchHit) {
+        file.raWindow = std::min(file.raWindow * 2, READAHEAD_MAX_WINDOW);
+    } else if (miss) {
+        file.raWindow = std::max(file.raWindow / 2, READAHEAD_MIN_WINDOW);
+    }
+
+    // 已提交的预读还剩一半以上时不再提交，减少预读请求的数量
+    size_t from = std::max(file.raScheduledEnd, lastBlock + 1);
+    if (from - (lastBlock + 1) > file.raWindow / 2) return;
+    size_t fileBlocks = (file.fileSize.load() + m_blockSize - 1) / m_blockSize;
+    size_t to = std::min(lastBlock + 1 + file.raWindow, fileBlocks); // 不预读文件末尾之后的块
+    if (from >= to) return;
+    file.raScheduledEnd = to;
+
+    {
+        std::lock_guard<std::mutex> queueLock(m_readaheadMutex);
+        m_readaheadQueue.push_back({fh, from, to - from});
+    }
+    m_readaheadCv.notify_all();
+}
+
+void CachedFileOperator::prefetchBlocks(int fh, size_t firstBlock, size_t numBlocks) {
+    std::vector<BlockFill> fills;
+    try {
+        for (size_t blockIndex = firstBlock; blockIndex < firstBlock + numBlocks; blockIndex++) {
+            size_t key = makeBlockKey(fh, blockIndex);
+            CacheShard& shard = shardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.index.contains(key)) continue; // 已在缓存中或正在读入
+            if (shardExhausted(shard)) continue; // 没有可用的槽，放弃预读该块
+
+            shard.policy->onMiss(key);
+            size_t slot = reserveSlot(shard, key);
+            beginFill(shard, slot);
+            fills.push_back({&shard, slot, blockIndex, -1});
+        }
+    }
+    catch (const std::runtime_error&) {
+        abortFills(fills);
+        throw;
+    }
+
+    try {
+        readBlocks(m_files[fh], fills);
+    }
+    catch (const std::runtime_error&) {
+        abortFills(fills);
+        throw;
+    }
+    for (BlockFill& fill : fills) {
+        CacheShard& shard = *fill.shard;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        finishFill(shard, fill.slot, fill.result);
+        if (fill.result == -1) continue; // 预读失败不影响正常读取，等真正访问时再报错
+        BlockInfo& info = shard.slots[fill.slot];
+        info.prefetched = true;
+        m_stats.add(STAT_READAHEAD_BLOCKS);
+        shard.policy->onInsert(fill.slot, info.key);
+    }
+}
+
+void CachedFileOperator::readaheadRun() {
+    std::unique_lock<std::mutex> lock(m_readaheadMutex);
+    while (true) {
+        m_readaheadCv.wait(lock, [this]() { return m_readaheadStop || !m_readaheadQueue.empty(); });
+        if (m_readaheadStop) return;
+        ReadaheadRequest request = m_readaheadQueue.front();
+        m_readaheadQueue.pop_front();
+        m_readaheadActiveFile = request.fh;
+        lock.unlock();
+
+        for (size_t i = 0; i < request.numBlocks; i += IO_BATCH_BLOCKS) {
+            try {
+                prefetchBlocks(request.fh, request.firstBlock + i, std::min(request.numBlocks - i, IO_BATCH_BLOCKS));
+            }
+            catch (const std::runtime_error& e) { // 淘汰时写回失败等错误，放弃本次预读
+                std::cerr << "Error during readahead: " << e.what() << std::endl;
+                break;
+            }
+        }
+
+        lock.lock();
+        m_readaheadActiveFile = -1;
+        m_readaheadCv.notify_all();
+    }
+}
+
+void CachedFileOperator::cancelReadahead(int fh) {
+    std::unique_lock<std::mutex> lock(m_readaheadMutex);
+    m_readaheadQueue.erase(std::remove_if(m_readaheadQueue.begin(), m_readaheadQueue.end(),
+        [fh](const ReadaheadRequest& request) { return request.fh == fh; }), m_readaheadQueue.end());
+    m_readaheadCv.wait(lock, [this, fh]() { return m_readaheadActiveFile != fh; });
+}
+
+void CachedFileOperator::setDirtyLimits(size_t slots) {
+    m_dirtyBackgroundLimit = slots * m_dirtyBackgroundRatio / 100;
+    // 没有后台线程时没有人会清理脏块，不限制写入
+    m_dirtyLimit = m_backgroundWriteback ? std::max(slots * m_dirtyRatio / 100, m_dirtyBackgroundLimit.load() + 1) : SIZE_MAX;
+    std::lock_guard<std::mutex> lock(m_writebackMutex);
+    m_writebackCv.notify_one(); // 阈值变小后可能已超过
+}
+
+void CachedFileOperator::throttleWriter() {
+    if (m_dirtyBlocks.load() < m_dirtyLimit.load()) return;
+    m_stats.add(STAT_WRITER_THROTTLES);
+    std::unique_lock<std::mutex> lock(m_writebackMutex);
+    // 最多等待一段时间：写回持续失败时写入照常进行，由淘汰时的前台写回报告错误
+    m_throttleCv.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+        return m_writebackStop || m_dirtyBlocks.load() < m_dirtyLimit.load();
+    });
+}
+
+void CachedFileOperator::writebackRun() {
+    std::unique_lock<std::mutex> lock(m_writebackMutex);
+    while (!m_writebackStop) {
+        if (m_dirtyBlocks.load() <= m_dirtyBackgroundLimit.load()) {
+            m_writebackCv.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        size_t cleaned = 0;
+        try {
+            cleaned = writebackRound();
+        }
+        catch (const std::runtime_error&) { // 块仍是脏块，稍后重试，或由淘汰时的前台写回报告错误
+        }
+        m_throttleCv.notify_all();
+        lock.lock();
+        if (cleaned == 0 && !m_writebackStop) { // 写回失败或块在写回期间又被修改，稍后重试
+            m_writebackCv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+}
+
+size_t CachedFileOperator::writebackRound() {
+    std::lock_guard<std::mutex> roundLock(m_writebackRoundMutex);
+    // 保护各分片最早变脏的几块，写回期间不会被淘汰；不持有分片锁，写入者照常修改这些块。
+    // 这些块留在淘汰策略中，访问记录不受写回影响；每个分片至少留一个可淘汰的槽，前台读写不会因写回而失败
+    size_t perShard = std::max<size_t>(1, IO_BATCH_BLOCKS / m_numShards);
+    std::vector<BlockWriteback> blocks;
+    std::vector<IoRequest> requests;
+    for (size_t n = 0; n < m_numShards && blocks.size() < IO_BATCH_BLOCKS; n++) {
+        CacheShard& shard = m_shards[(m_writebackNextShard + n) % m_numShards];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t taken = 0;
+        for (size_t slot = shard.dirtyList->back(0); slot != SlotLists::NONE && taken < perShard; slot = shard.dirtyList->previous(slot)) {
+            if (shard.loadingCount + shard.pinnedCount + shard.writebackPinned + 1 >= shard.capacity) break;
+            BlockInfo& info = shard.slots[slot];
+            pinForWriteback(shard, slot);
+            size_t length = writeBackLength(m_files[keyFile(info.key)], info.blockValidSize);
+            blocks.push_back({&shard, slot, info.version, {p_cacheBuffer.get() + info.cacheBufferOffset, length}});
+            taken++;
+        }
+    }
+    m_writebackNextShard = (m_writebackNextShard + 1) % m_numShards;
+    for (BlockWriteback& block : blocks) {
+        size_t key = block.shard->slots[block.slot].key; // 固定期间键不变
+        requests.push_back({m_files[keyFile(key)].fd, true, &block.iov, 1, static_cast<off_t>(keyBlock(key) * m_blockSize), 0, 0});
+    }
+    try {
+        m_stats.add(STAT_WRITE_CALLS, m_io->submit(requests.data(), requests.size()));
+    }
+    catch (const std::runtime_error&) { // I/O引擎出错：解除保护，否则这些块再也不能被淘汰
+        for (BlockWriteback& block : blocks) {
+            std::lock_guard<std::mutex> lock(block.shard->mutex);
+            unpinForWriteback(*block.shard, block.slot);
+        }
+        throw;
+    }
+
+    size_t cleaned = 0;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CacheShard& shard = *blocks[i].shard;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            BlockInfo& info = shard.slots[blocks[i].slot];
+            FileInfo& file = m_files[keyFile(info.key)];
+            bool written = requests[i].result == static_cast<ssize_t>(blocks[i].iov.iov_len);
+            try {
+                if (requests[i].result == -1 && requests[i].error == EINVAL && file.direct) {
+                    disableDirect(file); // 下一轮改用普通写入
+                }
+                if (written) {
+                    trimPadding(file, requests[i].offset + blocks[i].iov.iov_len);
+                }
+            }
+            catch (const std::runtime_error&) {
+                written = false;
+            }
+            // 写回期间被修改的块仍是脏块，下一轮再写；部分写入或失败的块留到下一轮或由前台写回
+            if (written && info.version == blocks[i].version) {
+                m_stats.add(STAT_BYTES_WRITTEN_BACK, info.blockValidSize);
+                m_stats.add(STAT_BLOCKS_WRITTEN_BACK);
+                markClean(shard, blocks[i].slot);
+                cleaned++;
+            }
+            unpinForWriteback(shard, blocks[i].slot);
+        }
+    }
+    return cleaned;
+}
+
+/* ---------------- BlockView ---------------- */
+
+BlockView::BlockView(const BlockView& other)
+    : m_owner(other.m_owner), m_shard(other.m_shard), m_slot(other.m_slot),
+      m_data(other.m_data), m_size(other.m_size), m_offset(other.m_offset) {
+    if (m_owner != nullptr) { // 复制视图时再固定一次
+        std::lock_guard<std::mutex> lock(m_shard->mutex);
+        m_owner->pinSlot(*m_shard, m_slot);
+    }
+}
+
+BlockView::BlockView(BlockView&& other) noexcept
+    : m_owner(other.m_owner), m_shard(other.m_shard), m_slot(other.m_slot),
+      m_data(other.m_data), m_size(other.m_size), m_offset(other.m_offset) {
+    other.m_owner = nullptr;
+}
+
+BlockView& BlockView::operator=(BlockView other) noexcept {
+    std::swap(m_owner, other.m_owner);
+    std::swap(m_shard, other.m_shard);
+    std::swap(m_slot, other.m_slot);
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_offset, other.m_offset);
+    return *this;
+}
+
+BlockView::~BlockView() {
+    release();
+}
+
+void BlockView::release() {
+    if (m_owner == nullptr) return;
+    m_owner->unpinSlot(*m_shard, m_slot);
+    m_owner = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+BlockView BlockRange::iterator::operator*() const {
+    return m_owner->pin(m_fh, m_offset, m_end - m_offset);
+}
+
+BlockRange::iterator& BlockRange::iterator::operator++() {
+    off_t nextBlock = (m_offset / m_owner->blockSize() + 1) * m_owner->blockSize();
+    m_offset = std::min(nextBlock, m_end);
+    return *this;
+}
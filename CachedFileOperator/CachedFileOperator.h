@@ -3,57 +3,448 @@
 #include <memory>
 #include <cstring>
 #include <string>
-#include <unordered_map>
-#include <list>
 #include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <map>
+#include <functional>
+#include <future>
+#include <exception>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <stdexcept>
 #include <iostream>
-#include <csignal> 
+#include <csignal>
+#include "BlockTable.h"
+#include "CompressedTier.h"
+#include "EvictionPolicy.h"
+#include "IoEngine.h"
+#include "Journal.h"
+#include "MappedFile.h"
+#include "CacheStatistics.h"
+#include "Trace.h"
 
 typedef struct BlockInfo{
-    size_t cacheBufferOffset; //该块在缓存区中的偏移量
+    size_t key; //缓存槽中块的键(句柄, 块号)
+    size_t cacheBufferOffset; //该槽在缓存区中的偏移量，构造时固定
     size_t blockValidSize; //该块数据的有效大小
-    std::list<size_t>::iterator accessOrderIterator; //该块在访问队列中的迭代器
+    bool dirty; //该块自读入或上次写回后是否被修改过
+    bool loading; //正在从文件读入，此时槽已占用但不受淘汰策略管理，访问者需等待
+    bool prefetched; //由预读装入且尚未被访问
+    size_t pins; //被BlockView固定的次数，大于0时不受淘汰策略管理，不会被淘汰
+    bool writingBack; //被后台写回固定：仍在淘汰策略中、访问记录照常更新，只是不会被选为淘汰对象
+    size_t version; //每次写入加1，后台写回完成时据此判断写回期间块是否又被修改
 }BlockInfo;
 
+typedef struct FileInfo{
+    int fd = -1; //文件描述符，-1表示该句柄空闲
+    off_t pos = 0; //该句柄的文件偏移量，只被read()/write()/lseek()使用
+    std::atomic<size_t> fileSize{0}; //文件大小（包含缓存中尚未写回的数据）
+    // 文件中数据的上界：从这里开始文件里只有0（或已在文件末尾之后），读入这之后的块无需读文件。
+    // 只在块留在缓存中时（持有分片的锁）增大，所以块被淘汰、写回之前它已经覆盖了该块的数据
+    std::atomic<size_t> storedSize{0};
+    // 已知的空洞（文件中确定为0的范围）：打开时用SEEK_HOLE查出，punchHole()时加入，写入时移除
+    std::mutex holesMutex;
+    std::map<size_t, size_t> holes; //起点 -> 终点，互不相邻、不重叠
+    std::atomic<bool> hasHoles{false}; //holes不为空，写入时据此跳过加锁
+    std::string fileName; //文件名
+    std::atomic<bool> direct{false}; //是否以O_DIRECT方式读写（绕过内核页缓存）
+    std::unique_ptr<MappedFile> mapped; //以OPEN_MMAP打开时的映射，此时读写不经过块缓存
+    std::unique_ptr<Journal> journal; //以OPEN_JOURNAL打开时的预写日志
+    std::shared_mutex journalMutex; //写入（记日志并写缓存）为共享，检查点为独占
+
+    // 顺序访问检测与预读状态，由raMutex保护
+    std::mutex raMutex;
+    size_t raNextBlock = 0; //顺序读取时下一次应访问的块号
+    size_t raWindow = 0; //预读窗口（块数），预读命中时增大，未命中时减小
+    size_t raScheduledEnd = 0; //已提交预读的块号上界（不含）
+}FileInfo;
+
+typedef struct CacheShard{
+    std::mutex mutex; //保护本分片的所有成员
+    BlockTable index; // 块表 ((句柄, 块号) -> 分片内的槽号)
+    std::vector<BlockInfo> slots; // 本分片的缓存槽
+    std::vector<size_t> freeSlots; // 空闲槽号
+    std::unique_ptr<EvictionPolicy> policy; // 淘汰策略，决定缓存满时淘汰哪个槽
+    std::unique_ptr<SlotLists> dirtyList; // 脏块按变脏的先后排列，尾部最早，后台写回从尾部开始
+    std::unique_ptr<CompressedTier> tier; // 压缩二级缓存，未启用时为空
+    std::condition_variable loaded; // 有块读入完成或解除固定时通知
+    size_t capacity = 0; // 启用的槽数，槽号小于capacity的槽才会被使用，resize()时调整
+    size_t loadingCount = 0; // 正在读入的块数
+    size_t pinnedCount = 0; // 被BlockView固定的块数
+    size_t writebackPinned = 0; // 被后台写回固定、且未被BlockView固定的块数，写回结束后即可淘汰
+}CacheShard;
+
+typedef struct BlockFill{
+    CacheShard* shard; //块所在的分片
+    size_t slot; //已分配并处于loading状态的槽
+    size_t blockIndex; //块号
+    ssize_t result; //读入的字节数，失败时为-1
+}BlockFill;
+
+typedef struct BlockWriteback{
+    CacheShard* shard; //块所在的分片
+    size_t slot; //被后台写回或flush固定的槽
+    size_t version; //开始写回时块的版本
+    struct iovec iov; //写回的数据，直接引用缓存区
+}BlockWriteback;
+
+// 分散/集中读写的一段：文件偏移量、缓冲区、长度。写入时buffer只被读取
+typedef struct IoSegment{
+    off_t offset; //文件偏移量
+    void* buffer; //数据缓冲区
+    size_t length; //长度
+}IoSegment;
+
+// 一段落在某一块内的部分
+typedef struct SegmentPiece{
+    size_t blockIndex; //块号
+    size_t blockOffset; //块内偏移量
+    char* buffer; //对应的缓冲区位置
+    size_t length; //长度
+}SegmentPiece;
+
+// 异步操作完成时调用，参数为操作抛出的异常，成功时为nullptr
+typedef std::function<void(std::exception_ptr)> AsyncCallback;
+
+typedef struct AsyncRequest{
+    std::function<void()> work; //在工作线程中执行的操作
+    AsyncCallback done; //完成回调
+}AsyncRequest;
+
+typedef struct ReadaheadRequest{
+    int fh; //文件句柄
+    size_t firstBlock; //起始块号
+    size_t numBlocks; //块数
+}ReadaheadRequest;
+
+enum OpenFlag : unsigned {
+    OPEN_DEFAULT = 0, //经过内核页缓存读写
+    OPEN_DIRECT = 1 << 0, //以O_DIRECT方式读写，数据只缓存在本缓存中；文件系统不支持时退回普通读写
+    OPEN_MMAP = 1 << 1, //映射整个文件，读写直接访问映射区，不经过块缓存；适合能放进内存、以读为主的文件。不能与OPEN_DIRECT同时使用
+    OPEN_SEQUENTIAL = 1 << 2, //访问模式提示：顺序访问（映射文件用madvise，其余用posix_fadvise）
+    OPEN_RANDOM = 1 << 3, //访问模式提示：随机访问
+    OPEN_JOURNAL = 1 << 4, //写入先记入预写日志（文件名 + ".journal"）并落盘后才返回，崩溃后下次open()时重放。不能与OPEN_MMAP同时使用
+};
+
+enum class ArenaPages {
+    NORMAL, // 普通4KB页
+    TRANSPARENT, // 透明大页：madvise(MADV_HUGEPAGE)，由内核尽量用2MB页映射
+    HUGETLB // MAP_HUGETLB：从预留的大页池分配，池为空时退回透明大页
+};
+
+const char* arenaPagesName(ArenaPages pages); // 页类型名
+
+struct ArenaUnmap { // 释放mmap映射的缓存区
+    size_t size = 0;
+    void operator()(char* p) const { munmap(p, size); }
+};
+
+/*
+缓存配置，构造时确定：
+    blockSize：块大小，必须是DIRECT_IO_ALIGNMENT的整数倍。小块适合随机小读写，大块适合顺序读写
+    cacheSize：初始缓存大小，按块大小向下取整
+    maxCacheSize：内存上限，resize()不能超过它；为0时等于cacheSize。构造时按上限保留地址空间，只有用到的部分占用内存
+    pages：缓存区的页类型。随机访问整个缓存区时大页能大幅减少TLB未命中；不支持时依次退回透明大页、普通页
+    prefault：构造和扩大缓存时预先分配并写入启用部分的物理页，避免第一次访问时的缺页中断落在读写路径上
+    latencyHistograms：是否记录read/write/flush的延迟直方图，每次调用多两次读时钟
+    statsDumpPath：不为空时，每隔statsDumpIntervalMs毫秒把统计快照以JSON行追加到该文件
+    journalCheckpointSize：OPEN_JOURNAL文件的日志超过该大小时做一次检查点：写回该文件的脏块、fdatasync数据文件，再截断日志
+    backgroundWriteback：是否启用后台写回线程。脏块超过启用槽数的dirtyBackgroundRatio%时，后台线程从最早变脏的块开始写回，
+        使淘汰时选中的块大多已是干净块；超过dirtyRatio%时写入者等待后台写回（类似内核的dirty_background_ratio与dirty_ratio）
+    compressedTierSize：压缩二级缓存大小，为0时不启用。启用后主缓存淘汰的块压缩后存入这里（不计入cacheSize），
+        未命中时先解压这里的块而不读文件；文本等可压缩数据的有效缓存容量可增加数倍，不可压缩的块直接绕过
+    tracePath：不为空时从构造开始把每次读、写、flush记录到该跟踪文件（见Trace.h），可用于重放比较不同配置
+    asyncWorkers：异步读写的工作线程数。未全部命中的异步请求交给这些线程，各线程的读写并发进行；为0时异步请求在调用线程中同步完成
+*/
+typedef struct CacheConfig{
+    size_t blockSize = 64 * 1024; //块大小：64KB
+    size_t cacheSize = 64 * 1024 * 1024; //缓存大小：64MB
+    size_t maxCacheSize = 0; //缓存大小上限
+    size_t numShards = 1; //分片数
+    EvictionPolicyType policy = EvictionPolicyType::LRU; //淘汰策略
+    bool readahead = true; //是否启用预读
+    IoEngineType ioEngine = IoEngineType::URING; //I/O引擎
+    ArenaPages pages = ArenaPages::TRANSPARENT; //缓存区页类型
+    bool prefault = false; //是否预先分配物理页
+    bool latencyHistograms = true; //是否记录延迟直方图
+    std::string statsDumpPath; //统计输出文件
+    size_t statsDumpIntervalMs = 1000; //统计输出间隔
+    size_t journalCheckpointSize = 64 * 1024 * 1024; //日志检查点阈值：64MB
+    bool backgroundWriteback = true; //是否启用后台写回
+    size_t dirtyBackgroundRatio = 10; //开始后台写回的脏块比例（%）
+    size_t dirtyRatio = 30; //限制写入的脏块比例（%）
+    size_t compressedTierSize = 0; //压缩二级缓存大小
+    std::string tracePath; //跟踪文件
+    size_t asyncWorkers = 4; //异步工作线程数
+}CacheConfig;
+
+class CachedFileOperator;
+
+/*
+缓存块的只读视图。持有期间所指向的块被固定在缓存中，不会被淘汰，因此可以直接读取缓存区而无需复制。
+复制视图会再固定一次，析构或release()时解除固定。视图必须在所属的文件关闭之前释放。
+其他线程对同一块的写入会直接反映在视图中。
+*/
+class BlockView {
+public:
+    BlockView() = default;
+    BlockView(const BlockView& other);
+    BlockView(BlockView&& other) noexcept;
+    BlockView& operator=(BlockView other) noexcept;
+    ~BlockView();
+
+    const char* data() const { return m_data; } // 视图数据
+    size_t size() const { return m_size; } // 视图大小
+    off_t offset() const { return m_offset; } // 视图数据在文件中的偏移量
+    explicit operator bool() const { return m_owner != nullptr; }
+    void release(); // 提前解除固定
+private:
+    friend class CachedFileOperator;
+    CachedFileOperator* m_owner = nullptr;
+    CacheShard* m_shard = nullptr;
+    size_t m_slot = 0;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    off_t m_offset = 0;
+};
+
+/*
+按块遍历文件中的一段字节范围，每个元素是一个最多一块大小的BlockView：
+    for (BlockView view : cfo.views(fh, offset, size)) { parse(view.data(), view.size()); }
+解引用时才固定对应的块，所以同一时刻只固定调用者持有的块。
+*/
+class BlockRange {
+public:
+    class iterator {
+    public:
+        BlockView operator*() const; // 固定当前块并返回视图
+        iterator& operator++(); // 移动到下一块的开头
+        bool operator!=(const iterator& other) const { return m_offset != other.m_offset; }
+    private:
+        friend class BlockRange;
+        iterator(CachedFileOperator* owner, int fh, off_t offset, off_t end) : m_owner(owner), m_fh(fh), m_offset(offset), m_end(end) {}
+        CachedFileOperator* m_owner;
+        int m_fh;
+        off_t m_offset, m_end;
+    };
+    iterator begin() const { return iterator(m_owner, m_fh, m_offset, m_end); }
+    iterator end() const { return iterator(m_owner, m_fh, m_end, m_end); }
+private:
+    friend class CachedFileOperator;
+    BlockRange(CachedFileOperator* owner, int fh, off_t offset, off_t end) : m_owner(owner), m_fh(fh), m_offset(offset), m_end(end) {}
+    CachedFileOperator* m_owner;
+    int m_fh;
+    off_t m_offset, m_end;
+};
+
 class CachedFileOperator {
 public:
-    static const size_t CACHE_BUFFER_SIZE = 64 * 1024 * 1024; // 缓存大小：64MB
-    static const size_t BLOCK_SIZE =  64 * 1024; // 块大小：64KB
-    static const size_t CACHE_MAX_BLOCK = 1 * 1024; //1024个块
+    static const size_t MAX_OPEN_FILES = 4096; // 最多同时打开的文件数
+    static const size_t READAHEAD_MIN_WINDOW = 4; // 最小预读窗口：4块
+    static const size_t READAHEAD_MAX_WINDOW = 64; // 最大预读窗口：64块（4MB）
+    static const size_t DIRECT_IO_ALIGNMENT = 4096; // O_DIRECT要求的内存地址、文件偏移量和长度的对齐
+    static const size_t IO_BATCH_BLOCKS = 64; // 一次批量读入的最大块数
 public:
-    static CachedFileOperator* getInstance(); // 单例模式
-
-    void open(const std::string& fileName); // 按文件名打开文件
-    void lseek(size_t offset, int whence); // 按指定方式获取文件偏移量
-    void read(char* buffer, size_t size); // 先尝试从缓存中读取数据，如果没有则读文件
-    void write(const char* data, size_t size); //在缓存中写数据，如果缓存数据被淘汰则写入文件
-    void close(); //关闭文件
-    void flush(); //将缓存数据写入文件
+    /*
+    blockSize、cacheSize、maxCacheSize：见CacheConfig。
+    numShards：缓存分片数。每个分片有独立的锁、淘汰策略和缓存块，块按(句柄, 块号)的哈希分配到分片，
+    访问不同分片的线程互不竞争。numShards为1时即单锁缓存。
+    policy：淘汰策略，每个分片各有一个实例。
+    readahead：是否启用预读。启用后检测每个文件的顺序读取，由后台线程提前读入后续的块。
+    ioEngine：I/O引擎。一次读取中缺失的多个块、一次flush中的所有写回都作为一批提交；内核不支持io_uring时退回同步读写。
+    */
+    explicit CachedFileOperator(const CacheConfig& config);
+    explicit CachedFileOperator(size_t numShards = 1, EvictionPolicyType policy = EvictionPolicyType::LRU, bool readahead = true,
+                                IoEngineType ioEngine = IoEngineType::URING); // 其余配置取默认值
+    ~CachedFileOperator();
+    CachedFileOperator(const CachedFileOperator&) = delete;
+    CachedFileOperator& operator=(const CachedFileOperator&) = delete;
+
+    // 除read()/write()/lseek()共享句柄偏移量外，其余接口均可被多个线程并发调用
+    int open(const std::string& fileName, unsigned flags = OPEN_DEFAULT); // 按文件名打开文件，返回文件句柄；flags为OpenFlag的组合
+    bool isDirect(int fh); // 文件是否真正以O_DIRECT方式读写
+    void lseek(int fh, off_t offset, int whence); // 按指定方式设置句柄的文件偏移量
+    void read(int fh, char* buffer, size_t size); // 先尝试从缓存中读取数据，如果没有则读文件
+    void write(int fh, const char* data, size_t size); //在缓存中写数据，如果缓存数据被淘汰则写入文件
+    void pread(int fh, char* buffer, size_t size, off_t offset); // 从指定偏移量读取，不使用也不修改句柄偏移量
+    void pwrite(int fh, const char* data, size_t size, off_t offset); // 写入指定偏移量，不使用也不修改句柄偏移量
+    // 分散/集中读写：一次调用中每个涉及的块只查找、提升一次，适合一条记录由许多小字段组成的场景
+    void readv(int fh, const struct iovec* iov, int iovcnt); // 从句柄偏移量处依次读入各缓冲区，并移动句柄偏移量
+    void writev(int fh, const struct iovec* iov, int iovcnt); // 把各缓冲区依次写到句柄偏移量处，并移动句柄偏移量
+    void preadv(int fh, const IoSegment* segments, size_t count); // 按各段的偏移量读取，不使用也不修改句柄偏移量
+    void pwritev(int fh, const IoSegment* segments, size_t count); // 按各段的偏移量写入，重叠部分以后面的段为准；不使用也不修改句柄偏移量
+    // 在文件中打洞（fallocate FALLOC_FL_PUNCH_HOLE），文件大小不变，之后读到0。缓存中的这部分数据被丢弃或清零，
+    // 日志文件先做一次检查点；与同一范围的并发读写之间先后不确定。不支持映射文件，文件系统不支持时抛出异常
+    void punchHole(int fh, off_t offset, size_t length);
+    // 为[offset, offset + length)预先分配磁盘空间（fallocate），keepSize为false时文件大小扩展到offset + length。不支持映射文件
+    void preallocate(int fh, off_t offset, size_t length, bool keepSize = false);
+    /*
+    异步读写：请求的块全部在缓存中时，在调用线程中完成（回调在返回前被调用）；否则命中的前缀先复制，
+    其余部分交给异步工作线程，多个未命中的请求的读写并发进行。句柄无效时直接抛出异常，其余错误通过回调或future报告。
+    完成之前buffer/data必须保持有效；重叠范围的并发异步写入先后不确定，文件关闭前需等待其异步请求完成。
+    回调可能在调用线程或工作线程中执行，不能抛出异常，也不能等待其他异步请求完成。
+    flushAsync只保证写回在它之前已经完成的写入。
+    */
+    std::future<void> readAsync(int fh, char* buffer, size_t size, off_t offset);
+    std::future<void> writeAsync(int fh, const char* data, size_t size, off_t offset);
+    std::future<void> flushAsync(int fh);
+    void readAsync(int fh, char* buffer, size_t size, off_t offset, AsyncCallback done);
+    void writeAsync(int fh, const char* data, size_t size, off_t offset, AsyncCallback done);
+    void flushAsync(int fh, AsyncCallback done);
+    BlockView pin(int fh, off_t offset, size_t size); // 固定offset所在的块，返回从offset开始、不超过块尾的只读视图；不支持映射文件
+    BlockRange views(int fh, off_t offset, size_t size); // 按块遍历[offset, offset + size)的只读视图，不复制数据
+    void close(int fh); //将该文件的缓存数据写回并关闭文件；该文件还有块被固定时抛出异常
+    void flush(int fh); //将某个文件的缓存数据写入文件；映射文件为msync，日志文件同时fdatasync并截断日志
+    void flush(); //将所有文件的缓存数据写入文件
+    bool isMapped(int fh); //文件是否以OPEN_MMAP方式打开
+    CacheStats getStats(); //统计快照：命中、淘汰、读写字节数、预读效果与延迟直方图，不阻塞读写
+    void startTrace(const std::string& path) { m_trace.start(path); } //开始把读、写、flush记录到跟踪文件，无法创建时抛出异常
+    void stopTrace() { m_trace.stop(); } //停止记录并写出跟踪文件
+    const char* ioEngine() const { return m_io->name(); } //实际使用的I/O引擎
+    size_t blockSize() const { return m_blockSize; } //块大小
+    size_t cacheSize(); //当前缓存大小
+    size_t maxCacheSize() const { return m_maxSlots * m_blockSize; } //缓存大小上限
+    ArenaPages arenaPages() const { return m_arenaPages; } //缓存区实际使用的页类型
+    /*
+    调整缓存大小（按块大小向下取整，限制在每个分片至少一块与maxCacheSize之间），返回调整后的大小。
+    缩小时淘汰高地址槽中的块（脏块先写回），并用madvise(MADV_DONTNEED)把这部分内存还给系统；
+    要淘汰的块被固定时抛出异常。
+    */
+    size_t resize(size_t cacheSize);
 private:
+    friend class BlockView;
     static void OnProcessExit();
 
 private:
-    CachedFileOperator(); // 私有构造函数
-    ~CachedFileOperator(); // 私有析构函数
+    static size_t makeBlockKey(int fh, size_t blockIndex); // 块键：(文件句柄, 块号)
+    static int keyFile(size_t key); // 从块键中取出文件句柄
+    static size_t keyBlock(size_t key); // 从块键中取出块号
+    FileInfo& getFile(int fh, const char* caller); // 检查并获取句柄对应的文件
+    CacheShard& shardOf(size_t key); // 块所在的分片
+
+    enum class BlockAccess { HIT, PREFETCH_HIT, MISS }; // 一次块访问的结果
+
+    // 缓存相关，调用者需持有分片的锁；读文件期间会暂时释放锁
+    void writeCache(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, const char* dataBlock, size_t dataSize, size_t blockOffset); // 写缓存
+    void storeData(CacheShard& shard, size_t slot, const char* dataBlock, size_t dataSize, size_t blockOffset); //把数据写入槽中的块并标记为脏块，调用者需持有分片的锁
+    BlockAccess readCache(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, char* buffer, size_t size, size_t blockOffset); //读缓存
+    BlockInfo& loadBlock(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t key, bool fill, BlockAccess* access = nullptr); //获取缓存块，缺失时分配缓存块，fill为true时从文件读入
+    size_t reserveSlot(CacheShard& shard, size_t key); //为块分配空闲槽或淘汰一个块，并登记到哈希表中
+    ssize_t fillSlot(std::unique_lock<std::mutex>& lock, CacheShard& shard, size_t slot); //释放锁读入槽中的块，读入期间该块处于loading状态
+    BlockAccess recordHit(CacheShard& shard, size_t slot); //统计一次命中并通知淘汰策略
+    void beginFill(CacheShard& shard, size_t slot); //标记槽正在读入
+    void finishFill(CacheShard& shard, size_t slot, ssize_t readBytes); //结束读入，失败时释放该槽；调用者需持有分片的锁
+    void readBlocks(FileInfo& file, std::vector<BlockFill>& fills); //不持有锁，把一批块作为一次批量请求读入
+    void readRange(int fh, FileInfo& file, char* buffer, size_t size, off_t offset); //pread()的实现，不记录跟踪
+    void writeRange(int fh, FileInfo& file, const char* data, size_t size, off_t offset); //pwrite()的实现，不记录跟踪
+    void splitSegments(const IoSegment* segments, size_t count, std::vector<SegmentPiece>& pieces); //把各段按块切分，按块号排序（同一块内保持段的顺序）
+
+    // 稀疏文件相关
+    ssize_t zeroBlockSize(FileInfo& file, size_t blockIndex); //块在文件中全为0时返回其在文件末尾之前的大小，无需读文件；否则返回-1
+    void markStored(FileInfo& file, size_t begin, size_t end); //缓存块中[begin, end)写入了数据，将来会写回文件；调用者需持有分片的锁
+    void addHole(FileInfo& file, size_t begin, size_t end); //记录一个已知的空洞，与相邻的空洞合并
+    void discardRange(int fh, size_t begin, size_t end); //丢弃缓存中[begin, end)的数据：整块在范围内的块移除，其余清零
+    void abortFills(std::vector<BlockFill>& fills); //放弃尚未读入的一批块，释放其槽
+
+    void pinSlot(CacheShard& shard, size_t slot); //固定一个槽，调用者需持有分片的锁
+    void unpinSlot(CacheShard& shard, size_t slot); //解除固定，由BlockView调用
+    void pinForWriteback(CacheShard& shard, size_t slot); //后台写回期间保护一个槽，不移出淘汰策略；调用者需持有分片的锁
+    void unpinForWriteback(CacheShard& shard, size_t slot); //解除写回保护；调用者需持有分片的锁
+    bool shardExhausted(CacheShard& shard); //分片中没有空闲槽，也没有可淘汰的块
+
+    // 预读相关
+    void updateReadahead(int fh, FileInfo& file, off_t offset, size_t size, bool prefetchHit, bool miss); //顺序访问检测，必要时提交预读
+    void prefetchBlocks(int fh, size_t firstBlock, size_t numBlocks); //批量预读一段块，已在缓存中或无槽可用的块跳过
+    void readaheadRun(); //预读线程
+    void cancelReadahead(int fh); //取消某个文件的预读并等待正在进行的预读结束
+    void writeBack(CacheShard& shard, size_t slot); //若缓存块是脏块，将其写回所属文件
+    void markDirty(CacheShard& shard, size_t slot); //标记为脏块并加入脏块链表，调用者需持有分片的锁
+    void markClean(CacheShard& shard, size_t slot); //脏块已写回或被丢弃，调用者需持有分片的锁
+    void writeBackRun(FileInfo& file, off_t fileOffset, std::vector<struct iovec>& iov); //用pwritev同步写完一段连续数据，处理部分写入与O_DIRECT退回
+    size_t writeBackLength(const FileInfo& file, size_t validSize); //写回长度，O_DIRECT时向上对齐
+    void trimPadding(FileInfo& file, size_t writtenEnd); //O_DIRECT对齐写入超出文件大小时截断回文件大小
+    void disableDirect(FileInfo& file); //文件系统拒绝O_DIRECT读写时退回普通读写
+    void flushBlocks(int fh); //写回某个文件（fh为-1时为所有文件）的全部脏块，相邻脏块合并写回；调用者需持有m_writebackRoundMutex
+    std::vector<size_t> flushBatch(const std::vector<size_t>& keys); //固定一批脏块后不持有分片锁写回，返回因分片槽不足留到下一批的键
+    void dropFileBlocks(CacheShard& shard, int fh); //移除分片中某个文件的全部缓存块，不写回
+    void shrinkShard(CacheShard& shard, size_t capacity); //把分片的槽数减少到capacity，淘汰被停用槽中的块
+    void checkpoint(int fh, FileInfo& file, size_t minJournalSize); //日志不小于minJournalSize时，写回并同步数据文件后截断日志
+
+    // 异步读写相关
+    size_t readResident(int fh, FileInfo& file, char* buffer, size_t size, off_t offset); //复制已在缓存中的前缀，不等待、不读文件，返回复制到的文件偏移量
+    size_t writeResident(int fh, FileInfo& file, const char* data, size_t size, off_t offset); //写入已在缓存中的前缀，返回写到的文件偏移量
+    void submitAsync(std::function<void()> work, AsyncCallback done); //交给工作线程执行，完成后调用done
+    void asyncRun(); //异步工作线程
+    static AsyncCallback promiseCallback(std::shared_ptr<std::promise<void>> promise); //完成时设置promise的回调
+
+    // 后台写回相关
+    void setDirtyLimits(size_t slots); //按启用的槽数计算脏块阈值
+    void throttleWriter(); //脏块超过上限时等待后台写回
+    void writebackRun(); //后台写回线程
+    size_t writebackRound(); //固定各分片最早变脏的一批块，不持有锁批量写回，返回变干净的块数
+    std::unique_ptr<char[], ArenaUnmap> p_cacheBuffer; // 缓存缓冲区，被所有打开的文件共享，按上限映射，页对齐以支持O_DIRECT
+    size_t m_blockSize; // 块大小
+    size_t m_maxSlots; // 槽数上限，槽i位于缓存区的i * m_blockSize处，属于分片i % m_numShards
+    size_t m_activeSlots; // 启用的槽数，即槽0 ~ m_activeSlots - 1
+    std::mutex m_resizeMutex; // 串行化resize()
+    ArenaPages m_arenaPages; // 缓存区实际使用的页类型
+    bool m_prefault; // 启用槽时是否预先分配物理页
+    void mapArena(ArenaPages pages); //按上限映射缓存区，大页不可用时退回
+    void prefaultArena(size_t begin, size_t end); //预先分配缓存区[begin, end)的物理页
+
+    EvictionPolicyType m_policyType; // 淘汰策略
+    size_t m_numShards; // 分片数
+    std::unique_ptr<CacheShard[]> m_shards; // 缓存分片
+
+    CacheStatistics m_stats; // 统计
+    TraceRecorder m_trace; // 操作跟踪
+    bool m_latencyHistograms; // 是否记录延迟直方图
+    std::unique_ptr<IoEngine> m_io; // I/O引擎
+    size_t m_journalCheckpointSize; // 日志检查点阈值
+
+    bool m_backgroundWriteback; // 是否启用后台写回
+    size_t m_dirtyBackgroundRatio, m_dirtyRatio; // 脏块比例阈值（%）
+    std::atomic<size_t> m_dirtyBlocks{0}; // 所有分片的脏块数
+    std::atomic<size_t> m_dirtyBackgroundLimit{0}; // 脏块数超过它时后台写回
+    std::atomic<size_t> m_dirtyLimit{SIZE_MAX}; // 脏块数达到它时限制写入
+    std::thread m_writebackThread; // 后台写回线程
+    std::mutex m_writebackMutex; // 保护m_writebackStop，配合两个条件变量
+    std::condition_variable m_writebackCv; // 脏块超过后台阈值或停止时通知后台线程
+    std::condition_variable m_throttleCv; // 一轮后台写回结束时通知被限速的写入者
+    bool m_writebackStop = false; // 后台线程停止标志
+    // 一轮后台写回期间持有。其他写回脏块的路径（flush、缩小缓存、关闭文件）也持有它，
+    // 避免后台线程较早开始的写入落在它们较新的写入之后，也避免遇到被后台写回固定的块
+    std::mutex m_writebackRoundMutex;
+    size_t m_writebackNextShard = 0; // 下一轮从哪个分片开始，只由后台线程访问
 
-    // LRU缓存相关
-    void writeCache(size_t blockIndex, const char* dataBlock, size_t dataSize, size_t blockOffset); // 写缓存
-    char* readCache(size_t blockIndex); //读缓存
-    std::unique_ptr<char[]> p_cacheBuffer; // 缓存缓冲区
+    std::mutex m_filesMutex; // 保护句柄的分配与释放
+    std::unique_ptr<FileInfo[]> m_files; // 文件表，下标即文件句柄
 
-    std::unordered_map<size_t, BlockInfo> m_cache; // 缓存哈希表 (块号 -> (缓冲区偏移量, 块有效大小, 块在访问队列中的迭代器))
-    std::list<size_t> m_accessOrder; // 访问顺序
-    
-    int m_fd; // 文件描述符
-    off_t m_pos; // 文件偏移量
+    bool m_readahead; // 是否启用预读
+    std::thread m_readaheadThread; // 预读线程
+    std::mutex m_readaheadMutex; // 保护预读队列
+    std::condition_variable m_readaheadCv; // 预读队列非空、停止或预读完成时通知
+    std::deque<ReadaheadRequest> m_readaheadQueue; // 预读请求队列
+    int m_readaheadActiveFile = -1; // 预读线程正在处理的文件
+    bool m_readaheadStop = false; // 预读线程停止标志
 
-    static CachedFileOperator* m_CFO;
+    std::vector<std::thread> m_asyncThreads; // 异步工作线程
+    std::mutex m_asyncMutex; // 保护异步请求队列
+    std::condition_variable m_asyncCv; // 队列非空或停止时通知
+    std::deque<AsyncRequest> m_asyncQueue; // 异步请求队列
+    bool m_asyncStop = false; // 工作线程停止标志，队列中剩余的请求仍会完成
 
 private:
     static void signalHandler(int signal);
+    static std::mutex s_instancesMutex;
+    static std::vector<CachedFileOperator*> s_instances; // 所有存活的实例，进程退出时统一写回
 };
 
-#endif // CachedFileOperator
\ No newline at end of file
+#endif // CachedFileOperator
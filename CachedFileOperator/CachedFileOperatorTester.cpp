@@ -4,8 +4,22 @@
 #include <cstring>
 #include <random>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <cmath>
+#include <future>
+#include <condition_variable>
 #include "CachedFileOperator.h"
 
 #define CACHED_TEST_FILE "test_with_cache.txt" // 带缓存的测试文件
@@ -14,6 +28,83 @@
 #define READ_SIZE 1024 * 1024 // 一次读取大小
 #define NUM_OPERATIONS 1024 // 操作次数
 #define NUM_REPEAT 128 //重复次数
+#define MULTI_FILE_PREFIX "multi_file_test_" // 多文件测试的文件名前缀
+#define MULTI_FILE_COUNT 128 // 多文件测试同时打开的文件数
+#define MULTI_FILE_SIZE (1024 * 1024) // 多文件测试中每个文件的最大大小
+#define MULTI_FILE_OPERATIONS 4096 // 多文件测试的操作次数
+#define CONCURRENT_TEST_FILE "concurrent_test.txt" // 并发测试文件
+#define CONCURRENT_FILE_SIZE (32 * 1024 * 1024) // 并发测试文件大小，小于缓存以测量命中路径
+#define CONCURRENT_IO_SIZE (4 * 1024) // 并发测试单次读写大小
+#define CONCURRENT_OPS_PER_THREAD 100000 // 每个线程的操作次数
+#define CONCURRENT_MAX_THREADS 16 // 最大线程数
+#define POLICY_TEST_FILE "policy_test.txt" // 淘汰策略测试文件
+#define POLICY_HOT_BLOCKS 512 // 热点数据块数（缓存容量的一半）
+#define POLICY_COLD_BLOCKS 4096 // 被顺序扫描的冷数据块数
+#define POLICY_ROUNDS 16 // 轮数：每轮先随机访问热点数据，再顺序扫描一段冷数据
+#define POLICY_HOT_OPS 8192 // 每轮随机访问热点数据的次数
+#define POLICY_SCAN_BLOCKS 1024 // 每轮顺序扫描的冷数据块数（等于缓存容量）
+#define SEQUENTIAL_TEST_FILE "sequential_test.txt" // 顺序读取测试文件
+#define SEQUENTIAL_FILE_SIZE (256 * 1024 * 1024) // 顺序读取测试文件大小
+#define SEQUENTIAL_READ_SIZE (64 * 1024) // 顺序读取时单次读取大小
+#define ZERO_COPY_TEST_FILE "zero_copy_test.txt" // 零拷贝读取测试文件
+#define ZERO_COPY_FILE_SIZE (32 * 1024 * 1024) // 零拷贝测试文件大小，小于缓存以测量命中路径
+#define ZERO_COPY_REPEAT 16 // 扫描次数
+#define IO_ENGINE_TEST_FILE "io_engine_test.txt" // I/O引擎测试文件
+#define IO_ENGINE_FILE_SIZE (64 * 1024 * 1024) // I/O引擎测试文件大小
+#define IO_ENGINE_READ_SIZE (1024 * 1024) // 每次读取1MB，即16个缺失的块
+#define IO_ENGINE_FLUSH_ROUNDS 8 // 写回测试轮数：每轮隔块写入后flush
+#define BLOCK_SIZE_TEST_FILE "block_size_test.txt" // 块大小测试文件
+#define BLOCK_SIZE_FILE_SIZE (128 * 1024 * 1024) // 块大小测试文件大小
+#define BLOCK_SIZE_RANDOM_SET (32 * 1024 * 1024) // 随机读取的范围，小于缓存以测量命中路径
+#define BLOCK_SIZE_RANDOM_OPS 200000 // 随机4KB读取次数
+#define RESIZE_TEST_FILE "resize_test.txt" // 缓存大小调整测试文件
+#define RESIZE_FILE_SIZE (64 * 1024 * 1024) // 写入的数据量，等于初始缓存大小
+#define HUGE_PAGE_TEST_FILE "huge_page_test.txt" // 大页测试文件
+#define HUGE_PAGE_CACHE_SIZE (256 * 1024 * 1024) // 大页测试的缓存与文件大小，整个文件都在缓存中
+#define HUGE_PAGE_RANDOM_OPS 500000 // 随机4KB读取次数
+#define STATS_TEST_FILE "stats_test.txt" // 统计测试文件
+#define STATS_DUMP_FILE "stats_test.jsonl" // 统计输出文件
+#define STATS_FILE_SIZE (128 * 1024 * 1024) // 统计测试文件大小，大于缓存以产生淘汰
+#define STATS_OPS 200000 // 统计测试的操作次数
+#define BLOCK_INDEX_LOOKUPS 4000000 // 块索引测试每种结构的命中次数
+#define MMAP_TEST_FILE "mmap_test.txt" // 映射文件测试的读取文件
+#define MMAP_WRITE_TEST_FILE "mmap_write_test.txt" // 映射文件测试的追加写入文件
+#define MMAP_FILE_SIZE (64 * 1024 * 1024) // 映射文件测试文件大小，小于缓存以比较命中路径
+#define MMAP_SCAN_REPEAT 8 // 顺序扫描次数
+#define MMAP_RANDOM_OPS 500000 // 随机4KB读取次数
+#define MMAP_APPEND_SIZE (64 * 1024) // 追加写入时单次写入大小
+#define JOURNAL_TEST_FILE "journal_test.txt" // 日志测试文件
+#define JOURNAL_FILE_SIZE (16 * 1024 * 1024) // 日志测试文件大小
+#define JOURNAL_CRASH_WRITES 2000 // 崩溃前的随机写入次数
+#define JOURNAL_IO_SIZE 4096 // 持久写入测试单次写入大小
+#define JOURNAL_OPS 4000 // 持久写入测试的总写入次数
+#define WRITEBACK_TEST_FILE "writeback_test.txt" // 后台写回测试文件
+#define WRITEBACK_FILE_SIZE (256 * 1024 * 1024) // 后台写回测试文件大小，4倍于缓存以持续淘汰
+#define WRITEBACK_OPS 40000 // 整块随机写入次数
+#define VECTORED_TEST_FILE "vectored_test.txt" // 分散/集中读写测试文件
+#define VECTORED_RECORDS 100000 // 记录数
+#define VECTORED_FIELDS 16 // 每条记录的字段数
+#define VECTORED_FIELD_SIZE 32 // 每个字段的大小
+#define TIER_TEST_FILE "tier_test.txt" // 压缩二级缓存测试文件
+#define TIER_FILE_SIZE (128 * 1024 * 1024) // 文本文件大小，2倍于主缓存
+#define TIER_SIZE (32 * 1024 * 1024) // 二级缓存大小
+#define TIER_OPS 20000 // 随机块访问次数，其中1/8为写入
+#define SPARSE_TEST_FILE "sparse_test.txt" // 稀疏文件测试文件
+#define SPARSE_APPEND_SIZE (64 * 1024 * 1024) // 追加写入的总大小
+#define SPARSE_RECORD_SIZE 4096 // 每次追加的大小
+#define SPARSE_FILE_SIZE (256 * 1024 * 1024) // 稀疏文件大小
+#define TRACE_DATA_FILE "trace_data.txt" // 重放时使用的数据文件（跟踪中的所有句柄映射到它）
+#define TRACE_RECORDED_FILE "trace_recorded.bin" // 重放时记录下来的跟踪
+#define TRACE_FILE_SIZE (256 * 1024 * 1024) // 跟踪访问的文件大小，4倍于缓存
+#define TRACE_OPS 100000 // Zipf与混合跟踪的操作数
+#define TRACE_IO_SIZE 4096 // 随机读写的大小
+#define TRACE_SCAN_SIZE (256 * 1024) // 顺序扫描每次读取的大小
+#define TRACE_SCAN_PASSES 2 // 顺序扫描整个文件的次数
+#define TRACE_ZIPF_THETA 0.99 // Zipf分布的偏斜度
+#define ASYNC_TEST_FILE "async_test.txt" // 异步读写测试文件
+#define ASYNC_FILE_SIZE (256 * 1024 * 1024) // 文件大小，4倍于缓存
+#define ASYNC_OPS 2048 // 随机读取次数，每次读取不同的块
+#define ASYNC_IO_SIZE 4096 // 每次读写的大小
 // 每次测试重新生成测试文件
 void prepareTestFiles() {
     if (std::fopen(CACHED_TEST_FILE, "r")) {
@@ -64,12 +155,19 @@ bool compareFiles(const std::string& file1, const std::string& file2) {
     return memcmp(buffer1, buffer2, bytesRead1) == 0; // 比较内容
 }
 
+// 输出写回统计：写回的字节数、因块干净而省去的字节数、写系统调用次数
+void printWriteBackStats(CachedFileOperator& cfo) {
+    CacheStats stats = cfo.getStats();
+    std::cout << "写回字节数: " << stats.bytesWrittenBack << "，省去写回的字节数: " << stats.bytesSkipped
+              << "，写回系统调用次数: " << stats.writeCalls << std::endl;
+}
+
 // 测试文件操作
 void testFileOperations() {
-    CachedFileOperator* cfo = CachedFileOperator::getInstance();
-    
-    cfo->open(CACHED_TEST_FILE); // 打开带缓存的测试文件
-    int fd = open(UNCACHED_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | O_DIRECT); // 打开不带缓存的测试文件
+    CachedFileOperator cfo;
+
+    int fh = cfo.open(CACHED_TEST_FILE); // 打开带缓存的测试文件
+    int fd = open(UNCACHED_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR); // 打开不带缓存的测试文件
 
     double totalCachedWriteTime = 0.0; // 总缓存写入时间
     double totalUncachedWriteTime = 0.0; // 总不带缓存写入时间
@@ -87,9 +185,9 @@ void testFileOperations() {
         fillRandomData(dataToWrite, DATA_SIZE); // 填充随机数据
         for (int j = 0; j < NUM_REPEAT; ++j){
             // 带缓存写入
-            cfo->lseek(off, SEEK_SET);
+            cfo.lseek(fh, off, SEEK_SET);
             auto startWriteCached = std::chrono::high_resolution_clock::now();
-            cfo->write(dataToWrite, DATA_SIZE);
+            cfo.write(fh, dataToWrite, DATA_SIZE);
             auto endWriteCached = std::chrono::high_resolution_clock::now();
             totalCachedWriteTime += std::chrono::duration<double>(endWriteCached - startWriteCached).count();
 
@@ -107,9 +205,9 @@ void testFileOperations() {
         // 模拟从随机偏移量频繁读取数据
         for (int j = 0; j < NUM_REPEAT; ++j) { // 从不同偏移量重复读取数据
             char cachedBuffer[READ_SIZE + 1] = {0};
-            cfo->lseek(readOff, SEEK_SET);
+            cfo.lseek(fh, readOff, SEEK_SET);
             auto startReadCached = std::chrono::high_resolution_clock::now();
-            cfo->read(cachedBuffer, READ_SIZE);
+            cfo.read(fh, cachedBuffer, READ_SIZE);
             auto endReadCached = std::chrono::high_resolution_clock::now();
             totalCachedReadTime += std::chrono::duration<double>(endReadCached - startReadCached).count();
 
@@ -140,7 +238,1430 @@ void testFileOperations() {
     std::cout << "不带缓存-总读取时间: " << totalUncachedReadTime << " 秒" << std::endl;
 
     close(fd); // 关闭不带缓存的文件描述符
-    cfo->flush(); // 刷新缓存数据到文件
+    cfo.close(fh); // 刷新缓存数据到文件并关闭
+    printWriteBackStats(cfo);
+}
+
+// 测试一个实例同时缓存多个文件：所有文件共享同一个缓存区，总数据量超过缓存大小以触发跨文件淘汰
+// flags为OPEN_DIRECT时同时检验O_DIRECT下非对齐读写与文件大小是否正确
+bool testMultipleFiles(unsigned flags) {
+    std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
+    std::vector<std::string> expected(MULTI_FILE_COUNT); // 每个文件应有的内容
+    std::vector<int> handles(MULTI_FILE_COUNT);
+    bool ok = true;
+    {
+        CachedFileOperator cfo;
+        for (int i = 0; i < MULTI_FILE_COUNT; ++i) {
+            std::string name = MULTI_FILE_PREFIX + std::to_string(i) + ".txt";
+            std::remove(name.c_str());
+            handles[i] = cfo.open(name, flags);
+        }
+        if ((flags & OPEN_DIRECT) && !cfo.isDirect(handles[0])) {
+            std::cout << "文件系统不支持O_DIRECT，已退回普通读写。" << std::endl;
+        }
+
+        std::uniform_int_distribution<int> fileDist(0, MULTI_FILE_COUNT - 1);
+        std::uniform_int_distribution<size_t> sizeDist(1, 256 * 1024);
+        std::vector<char> pool(MULTI_FILE_SIZE); // 预先生成的随机数据池，每次写入取其中一段
+        fillRandomData(pool.data(), pool.size());
+        for (int op = 0; op < MULTI_FILE_OPERATIONS; ++op) {
+            int i = fileDist(rng);
+            size_t size = sizeDist(rng);
+            std::uniform_int_distribution<size_t> offsetDist(0, std::min(expected[i].size(), MULTI_FILE_SIZE - size));
+            size_t off = offsetDist(rng);
+            std::uniform_int_distribution<size_t> poolDist(0, pool.size() - size);
+            const char* data = pool.data() + poolDist(rng);
+
+            cfo.lseek(handles[i], off, SEEK_SET);
+            cfo.write(handles[i], data, size);
+            if (expected[i].size() < off + size) expected[i].resize(off + size);
+            expected[i].replace(off, size, data, size);
+        }
+
+        // 通过缓存读回并校验
+        for (int i = 0; i < MULTI_FILE_COUNT; ++i) {
+            std::vector<char> buffer(expected[i].size());
+            cfo.lseek(handles[i], 0, SEEK_SET);
+            cfo.read(handles[i], buffer.data(), buffer.size());
+            if (memcmp(buffer.data(), expected[i].data(), buffer.size()) != 0) {
+                std::cout << "多文件测试：文件 " << i << " 通过缓存读回的内容不一致！" << std::endl;
+                ok = false;
+            }
+        }
+        for (int i = 0; i < MULTI_FILE_COUNT; ++i) {
+            cfo.close(handles[i]);
+        }
+        printWriteBackStats(cfo);
+    }
+
+    // 校验写回到磁盘的内容
+    for (int i = 0; i < MULTI_FILE_COUNT; ++i) {
+        std::string name = MULTI_FILE_PREFIX + std::to_string(i) + ".txt";
+        int fd = open(name.c_str(), O_RDONLY);
+        std::vector<char> buffer(expected[i].size() + 1);
+        ssize_t bytesRead = read(fd, buffer.data(), buffer.size());
+        close(fd);
+        std::remove(name.c_str());
+        if (bytesRead != static_cast<ssize_t>(expected[i].size()) || memcmp(buffer.data(), expected[i].data(), bytesRead) != 0) {
+            std::cout << "多文件测试：文件 " << i << " 写回磁盘的内容不一致！" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// 以numShards个分片运行并发读写（90%读，10%写），返回每秒操作数
+double runConcurrentWorkload(size_t numShards, int numThreads) {
+    CachedFileOperator cfo(numShards);
+    int fh = cfo.open(CONCURRENT_TEST_FILE);
+    std::vector<char> warmup(CONCURRENT_FILE_SIZE);
+    cfo.pread(fh, warmup.data(), warmup.size(), 0); // 预热，使整个文件进入缓存
+
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&cfo, fh, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<size_t> offsetDist(0, CONCURRENT_FILE_SIZE - CONCURRENT_IO_SIZE);
+            std::uniform_int_distribution<int> opDist(0, 9);
+            char buffer[CONCURRENT_IO_SIZE];
+            for (int i = 0; i < CONCURRENT_OPS_PER_THREAD; ++i) {
+                size_t off = offsetDist(rng);
+                if (opDist(rng) == 0) {
+                    cfo.pwrite(fh, buffer, CONCURRENT_IO_SIZE, off);
+                } else {
+                    cfo.pread(fh, buffer, CONCURRENT_IO_SIZE, off);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return static_cast<double>(numThreads) * CONCURRENT_OPS_PER_THREAD / seconds;
+}
+
+// 测试多线程下的吞吐量扩展性：单锁缓存与分片缓存对比
+void testConcurrentScaling() {
+    std::vector<char> data(CONCURRENT_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(CONCURRENT_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data.data(), data.size());
+    close(fd);
+
+    const size_t shardedShards = 64;
+    std::cout << "并发测试（" << CONCURRENT_IO_SIZE / 1024 << "KB随机读写，90%读）：" << std::endl;
+    std::cout << std::setw(8) << "线程数" << std::setw(20) << "单锁(ops/s)" << std::setw(20) << "64分片(ops/s)" << std::endl;
+    for (int numThreads = 1; numThreads <= CONCURRENT_MAX_THREADS; numThreads *= 2) {
+        double single = runConcurrentWorkload(1, numThreads);
+        double sharded = runConcurrentWorkload(shardedShards, numThreads);
+        std::cout << std::setw(8) << numThreads << std::setw(20) << std::fixed << std::setprecision(0) << single
+                  << std::setw(20) << sharded << std::endl;
+    }
+    std::remove(CONCURRENT_TEST_FILE);
+}
+
+// 扫描+热点负载：热点数据应常驻缓存，而周期性的大范围顺序扫描会冲掉LRU的全部工作集
+void testEvictionPolicies() {
+    const size_t blockSize = CacheConfig().blockSize;
+    int fd = open(POLICY_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, (POLICY_HOT_BLOCKS + POLICY_COLD_BLOCKS) * blockSize);
+    close(fd);
+
+    const EvictionPolicyType policies[] = {
+        EvictionPolicyType::LRU, EvictionPolicyType::CLOCK, EvictionPolicyType::TWO_Q, EvictionPolicyType::ARC
+    };
+    std::cout << "淘汰策略测试（热点" << POLICY_HOT_BLOCKS << "块随机访问 + 每轮顺序扫描" << POLICY_SCAN_BLOCKS << "块）：" << std::endl;
+    std::cout << std::setw(8) << "策略" << std::setw(12) << "命中率" << std::setw(14) << "ns/op" << std::endl;
+    for (EvictionPolicyType policy : policies) {
+        CachedFileOperator cfo(1, policy, false); // 关闭预读，只比较淘汰策略本身
+        int fh = cfo.open(POLICY_TEST_FILE);
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> hotDist(0, POLICY_HOT_BLOCKS - 1);
+        std::vector<char> buffer(blockSize);
+        size_t scanBlock = 0, ops = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < POLICY_ROUNDS; ++round) {
+            for (int i = 0; i < POLICY_HOT_OPS; ++i, ++ops) { // 随机读热点块中的4KB
+                cfo.pread(fh, buffer.data(), 4096, hotDist(rng) * blockSize);
+            }
+            for (int i = 0; i < POLICY_SCAN_BLOCKS; ++i, ++ops) { // 顺序扫描冷数据
+                size_t block = POLICY_HOT_BLOCKS + scanBlock;
+                cfo.pread(fh, buffer.data(), buffer.size(), block * blockSize);
+                scanBlock = (scanBlock + 1) % POLICY_COLD_BLOCKS;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        CacheStats stats = cfo.getStats();
+        double hitRatio = static_cast<double>(stats.hits) / (stats.hits + stats.misses);
+        double nsPerOp = std::chrono::duration<double, std::nano>(end - start).count() / ops;
+        std::cout << std::setw(8) << evictionPolicyName(policy) << std::setw(12) << std::fixed << std::setprecision(4) << hitRatio
+                  << std::setw(14) << std::setprecision(1) << nsPerOp << std::endl;
+        cfo.close(fh);
+    }
+    std::remove(POLICY_TEST_FILE);
+}
+
+// 顺序读取一个不在页缓存中的文件，返回吞吐量（MB/s）
+double runSequentialRead(bool readahead, CacheStats& stats) {
+    int fd = open(SEQUENTIAL_TEST_FILE, O_RDONLY);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED); // 清除页缓存，使读取真正到达设备
+    close(fd);
+
+    CachedFileOperator cfo(1, EvictionPolicyType::LRU, readahead);
+    int fh = cfo.open(SEQUENTIAL_TEST_FILE);
+    std::vector<char> buffer(SEQUENTIAL_READ_SIZE);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t off = 0; off < SEQUENTIAL_FILE_SIZE; off += SEQUENTIAL_READ_SIZE) {
+        cfo.read(fh, buffer.data(), buffer.size());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    stats = cfo.getStats();
+    cfo.close(fh);
+    return SEQUENTIAL_FILE_SIZE / (1024.0 * 1024.0) / std::chrono::duration<double>(end - start).count();
+}
+
+// 顺序读取测试：比较关闭与开启预读时的吞吐量
+void testSequentialReadahead() {
+    std::vector<char> data(1024 * 1024);
+    fillRandomData(data.data(), data.size());
+    int fd = open(SEQUENTIAL_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    for (size_t off = 0; off < SEQUENTIAL_FILE_SIZE; off += data.size()) {
+        write(fd, data.data(), data.size());
+    }
+    fsync(fd); // 脏页写回后才能从页缓存中清除
+    close(fd);
+
+    CacheStats stats;
+    std::cout << "顺序读取测试（" << SEQUENTIAL_FILE_SIZE / (1024 * 1024) << "MB，每次" << SEQUENTIAL_READ_SIZE / 1024 << "KB）：" << std::endl;
+    double without = runSequentialRead(false, stats);
+    std::cout << "关闭预读: " << std::fixed << std::setprecision(1) << without << " MB/s，未命中块数: " << stats.misses << std::endl;
+    double with = runSequentialRead(true, stats);
+    std::cout << "开启预读: " << with << " MB/s，未命中块数: " << stats.misses << "，预读块数: " << stats.readaheadBlocks
+              << "，预读命中: " << stats.readaheadHits << "，预读浪费: " << stats.readaheadWasted << std::endl;
+    std::remove(SEQUENTIAL_TEST_FILE);
+}
+
+// 零拷贝读取测试：缓存命中时比较pread拷贝与固定块视图两种方式扫描整个文件的吞吐量
+void testZeroCopyScan() {
+    std::vector<char> data(ZERO_COPY_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(ZERO_COPY_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data.data(), data.size());
+    close(fd);
+
+    CachedFileOperator cfo;
+    int fh = cfo.open(ZERO_COPY_TEST_FILE);
+    std::vector<char> buffer(ZERO_COPY_FILE_SIZE);
+    cfo.pread(fh, buffer.data(), buffer.size(), 0); // 预热，使整个文件进入缓存
+
+    unsigned long copySum = 0, viewSum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < ZERO_COPY_REPEAT; r++) {
+        cfo.pread(fh, buffer.data(), buffer.size(), 0);
+        for (size_t i = 0; i < buffer.size(); i += 64) {
+            copySum += (unsigned char)buffer[i];
+        }
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < ZERO_COPY_REPEAT; r++) {
+        for (BlockView view : cfo.views(fh, 0, ZERO_COPY_FILE_SIZE)) {
+            for (size_t i = 0; i < view.size(); i += 64) {
+                viewSum += (unsigned char)view.data()[i];
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+    std::remove(ZERO_COPY_TEST_FILE);
+
+    double total = (double)ZERO_COPY_FILE_SIZE * ZERO_COPY_REPEAT / (1024.0 * 1024.0);
+    std::cout << "零拷贝读取测试（" << ZERO_COPY_FILE_SIZE / (1024 * 1024) << "MB，扫描" << ZERO_COPY_REPEAT << "次）：" << std::endl;
+    std::cout << "pread拷贝: " << std::fixed << std::setprecision(1) << total / std::chrono::duration<double>(mid - start).count() << " MB/s" << std::endl;
+    std::cout << "块视图: " << total / std::chrono::duration<double>(end - mid).count() << " MB/s" << std::endl;
+    std::cout << (copySum == viewSum ? "两种方式读到的数据一致。" : "两种方式读到的数据不一致！") << std::endl;
+}
+
+// 已排序数组的百分位数
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index];
+}
+
+void printLatency(const char* name, std::vector<double>& latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "  " << name << "延迟(us) p50: " << std::fixed << std::setprecision(1) << percentile(latencies, 0.5)
+              << "，p99: " << percentile(latencies, 0.99) << "，max: " << latencies.back() << std::endl;
+}
+
+// I/O引擎测试：1MB读取全部未命中时的批量读入，以及隔块写入（无法合并）后flush的批量写回
+void testIoEngines() {
+    std::vector<char> data(IO_ENGINE_READ_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(IO_ENGINE_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    for (size_t off = 0; off < IO_ENGINE_FILE_SIZE; off += data.size()) {
+        write(fd, data.data(), data.size());
+    }
+    fsync(fd);
+    close(fd);
+
+    const IoEngineType engines[] = {IoEngineType::SYNC, IoEngineType::URING};
+    std::cout << "I/O引擎测试（" << IO_ENGINE_FILE_SIZE / (1024 * 1024) << "MB，每次读取" << IO_ENGINE_READ_SIZE / 1024 << "KB）：" << std::endl;
+    for (IoEngineType engine : engines) {
+        fd = open(IO_ENGINE_TEST_FILE, O_RDONLY);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED); // 清除页缓存，使读取真正到达设备
+        close(fd);
+
+        CachedFileOperator cfo(1, EvictionPolicyType::LRU, false, engine); // 关闭预读，每次读取都缺失
+        int fh = cfo.open(IO_ENGINE_TEST_FILE);
+        std::vector<double> readLatencies, flushLatencies;
+        for (size_t off = 0; off < IO_ENGINE_FILE_SIZE; off += IO_ENGINE_READ_SIZE) {
+            auto start = std::chrono::high_resolution_clock::now();
+            cfo.pread(fh, data.data(), IO_ENGINE_READ_SIZE, off);
+            auto end = std::chrono::high_resolution_clock::now();
+            readLatencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        size_t readCalls = cfo.getStats().readCalls;
+
+        // 缓存中现在是文件的后64MB（全部），隔块写入使每个脏块单独成段，同步引擎每块一次写调用
+        for (int round = 0; round < IO_ENGINE_FLUSH_ROUNDS; ++round) {
+            for (size_t block = round % 2; block < cfo.cacheSize() / cfo.blockSize(); block += 2) {
+                cfo.pwrite(fh, data.data(), 4096, block * cfo.blockSize());
+            }
+            auto start = std::chrono::high_resolution_clock::now();
+            cfo.flush(fh);
+            auto end = std::chrono::high_resolution_clock::now();
+            flushLatencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        CacheStats stats = cfo.getStats();
+        std::cout << cfo.ioEngine() << "：读系统调用 " << readCalls << " 次（" << stats.misses << "个缺失块），写回系统调用 "
+                  << stats.writeCalls << " 次（" << IO_ENGINE_FLUSH_ROUNDS << "次flush，每次" << cfo.cacheSize() / cfo.blockSize() / 2 << "个脏块）" << std::endl;
+        printLatency("1MB读取", readLatencies);
+        printLatency("flush", flushLatencies);
+        cfo.close(fh);
+    }
+    std::remove(IO_ENGINE_TEST_FILE);
+}
+
+// 块大小测试：不同块大小下冷数据顺序读取与缓存内随机4KB读取的吞吐量
+void testBlockSizes() {
+    std::vector<char> data(1024 * 1024);
+    fillRandomData(data.data(), data.size());
+    int fd = open(BLOCK_SIZE_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    for (size_t off = 0; off < BLOCK_SIZE_FILE_SIZE; off += data.size()) {
+        write(fd, data.data(), data.size());
+    }
+    fsync(fd);
+    close(fd);
+
+    const size_t blockSizes[] = {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024};
+    std::cout << "块大小测试（缓存64MB，顺序读取" << BLOCK_SIZE_FILE_SIZE / (1024 * 1024) << "MB冷数据，随机4KB读取"
+              << BLOCK_SIZE_RANDOM_SET / (1024 * 1024) << "MB热数据）：" << std::endl;
+    std::cout << std::setw(10) << "块大小" << std::setw(16) << "顺序(MB/s)" << std::setw(16) << "随机(ops/s)" << std::endl;
+    for (size_t blockSize : blockSizes) {
+        fd = open(BLOCK_SIZE_TEST_FILE, O_RDONLY);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED); // 清除页缓存，使顺序读取真正到达设备
+        close(fd);
+
+        CacheConfig config;
+        config.blockSize = blockSize;
+        CachedFileOperator cfo(config);
+        int fh = cfo.open(BLOCK_SIZE_TEST_FILE);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t off = 0; off < BLOCK_SIZE_FILE_SIZE; off += data.size()) {
+            cfo.pread(fh, data.data(), data.size(), off);
+        }
+        auto mid = std::chrono::high_resolution_clock::now();
+
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> dist(0, BLOCK_SIZE_RANDOM_SET / 4096 - 1);
+        for (size_t off = 0; off < BLOCK_SIZE_RANDOM_SET; off += data.size()) { // 预热
+            cfo.pread(fh, data.data(), data.size(), off);
+        }
+        auto randomStart = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < BLOCK_SIZE_RANDOM_OPS; ++i) {
+            cfo.pread(fh, data.data(), 4096, dist(rng) * 4096);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        cfo.close(fh);
+
+        double sequential = BLOCK_SIZE_FILE_SIZE / (1024.0 * 1024.0) / std::chrono::duration<double>(mid - start).count();
+        double random = BLOCK_SIZE_RANDOM_OPS / std::chrono::duration<double>(end - randomStart).count();
+        std::cout << std::setw(8) << blockSize / 1024 << "KB" << std::setw(16) << std::fixed << std::setprecision(1) << sequential
+                  << std::setw(16) << std::setprecision(0) << random << std::endl;
+    }
+    std::remove(BLOCK_SIZE_TEST_FILE);
+}
+
+// 进程的常驻内存（MB）
+double residentMB() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+}
+
+// 缓存大小调整测试：写满缓存后缩小，脏块应被写回、内存应被释放；再扩大后继续使用
+bool testResize() {
+    std::vector<char> data(RESIZE_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    CacheConfig config;
+    config.maxCacheSize = 256 * 1024 * 1024;
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(RESIZE_TEST_FILE);
+    cfo.pwrite(fh, data.data(), data.size(), 0);
+    double fullRss = residentMB();
+    cfo.resize(8 * 1024 * 1024); // 缩小时淘汰的脏块被写回
+    double shrunkRss = residentMB();
+    std::cout << "缓存大小调整测试：64MB时常驻内存 " << std::fixed << std::setprecision(1) << fullRss << " MB，缩小到"
+              << cfo.cacheSize() / (1024 * 1024) << "MB后 " << shrunkRss << " MB，";
+    cfo.resize(cfo.maxCacheSize());
+    std::cout << "扩大到" << cfo.cacheSize() / (1024 * 1024) << "MB" << std::endl;
+
+    std::vector<char> buffer(RESIZE_FILE_SIZE);
+    cfo.pread(fh, buffer.data(), buffer.size(), 0);
+    cfo.close(fh);
+    std::remove(RESIZE_TEST_FILE);
+    return memcmp(buffer.data(), data.data(), data.size()) == 0;
+}
+
+// 大页测试：整个文件在缓存中时随机4KB读取的延迟，以及是否预先分配物理页对首次装入的影响
+void testHugePages() {
+    std::vector<char> data(1024 * 1024);
+    fillRandomData(data.data(), data.size());
+    int fd = open(HUGE_PAGE_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    for (size_t off = 0; off < HUGE_PAGE_CACHE_SIZE; off += data.size()) {
+        write(fd, data.data(), data.size());
+    }
+    close(fd);
+
+    const ArenaPages modes[] = {ArenaPages::NORMAL, ArenaPages::TRANSPARENT, ArenaPages::HUGETLB};
+    std::cout << "大页测试（缓存" << HUGE_PAGE_CACHE_SIZE / (1024 * 1024) << "MB，随机4KB读取" << HUGE_PAGE_RANDOM_OPS << "次）：" << std::endl;
+    std::cout << std::setw(10) << "请求" << std::setw(10) << "实际" << std::setw(12) << "预分配" << std::setw(12) << "构造(ms)"
+              << std::setw(18) << "首次装入(ms)" << std::setw(10) << "p50(ns)" << std::setw(10) << "p99(ns)" << std::setw(10) << "平均(ns)" << std::endl;
+    for (ArenaPages mode : modes) {
+        for (bool prefault : {false, true}) {
+            CacheConfig config;
+            config.cacheSize = HUGE_PAGE_CACHE_SIZE;
+            config.readahead = false;
+            config.pages = mode;
+            config.prefault = prefault;
+            auto start = std::chrono::high_resolution_clock::now();
+            CachedFileOperator cfo(config);
+            auto constructed = std::chrono::high_resolution_clock::now();
+            int fh = cfo.open(HUGE_PAGE_TEST_FILE);
+            for (size_t off = 0; off < HUGE_PAGE_CACHE_SIZE; off += data.size()) { // 装入整个文件，未预分配时包含缺页中断
+                cfo.pread(fh, data.data(), data.size(), off);
+            }
+            auto loaded = std::chrono::high_resolution_clock::now();
+
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<size_t> dist(0, HUGE_PAGE_CACHE_SIZE / 4096 - 1);
+            std::vector<double> latencies(HUGE_PAGE_RANDOM_OPS);
+            auto randomStart = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < HUGE_PAGE_RANDOM_OPS; ++i) {
+                auto opStart = std::chrono::high_resolution_clock::now();
+                cfo.pread(fh, data.data(), 4096, dist(rng) * 4096);
+                auto opEnd = std::chrono::high_resolution_clock::now();
+                latencies[i] = std::chrono::duration<double, std::nano>(opEnd - opStart).count();
+            }
+            auto randomEnd = std::chrono::high_resolution_clock::now();
+            cfo.close(fh);
+
+            std::sort(latencies.begin(), latencies.end());
+            std::cout << std::setw(10) << arenaPagesName(mode) << std::setw(10) << arenaPagesName(cfo.arenaPages()) << std::setw(8) << (prefault ? "是" : "否")
+                      << std::setw(12) << std::fixed << std::setprecision(1) << std::chrono::duration<double, std::milli>(constructed - start).count()
+                      << std::setw(14) << std::chrono::duration<double, std::milli>(loaded - constructed).count()
+                      << std::setw(10) << std::setprecision(0) << percentile(latencies, 0.5) << std::setw(10) << percentile(latencies, 0.99)
+                      << std::setw(10) << std::chrono::duration<double, std::nano>(randomEnd - randomStart).count() / HUGE_PAGE_RANDOM_OPS << std::endl;
+        }
+    }
+    std::remove(HUGE_PAGE_TEST_FILE);
+}
+
+// 运行统计测试的混合负载：4KB随机读写（80%读），每隔一段时间flush一次，返回每次操作的平均耗时(ns)
+double runStatsWorkload(CachedFileOperator& cfo, int fh) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, STATS_FILE_SIZE / 4096 - 1);
+    std::vector<char> buffer(4096, 'x');
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < STATS_OPS; ++i) {
+        size_t off = dist(rng) % (dist(rng) + 1) * 4096; // 偏向文件开头，使命中率在0与1之间
+        if (i % 5 == 0) {
+            cfo.pwrite(fh, buffer.data(), buffer.size(), off);
+        } else {
+            cfo.pread(fh, buffer.data(), buffer.size(), off);
+        }
+        if (i % 20000 == 0) {
+            cfo.flush(fh);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / STATS_OPS;
+}
+
+// 统计测试：输出快照与延迟直方图，检查定期输出的JSON行，并比较关闭延迟直方图时的开销
+void testStatistics() {
+    int fd = open(STATS_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, STATS_FILE_SIZE);
+    close(fd);
+    std::remove(STATS_DUMP_FILE);
+
+    double withoutHistograms;
+    {
+        CacheConfig config;
+        config.latencyHistograms = false;
+        CachedFileOperator cfo(config);
+        int fh = cfo.open(STATS_TEST_FILE);
+        withoutHistograms = runStatsWorkload(cfo, fh);
+        cfo.close(fh);
+    }
+
+    CacheStats stats;
+    double withHistograms;
+    {
+        CacheConfig config;
+        config.statsDumpPath = STATS_DUMP_FILE;
+        config.statsDumpIntervalMs = 100;
+        CachedFileOperator cfo(config);
+        int fh = cfo.open(STATS_TEST_FILE);
+        withHistograms = runStatsWorkload(cfo, fh);
+        cfo.close(fh);
+        stats = cfo.getStats();
+    }
+
+    std::cout << "统计测试（4KB随机读写" << STATS_OPS << "次，80%读）：" << std::endl;
+    std::cout << "命中率: " << std::fixed << std::setprecision(4) << stats.hitRatio() << "，淘汰: " << stats.evictions
+              << "，写回脏块: " << stats.blocksWrittenBack << "，读入字节: " << stats.bytesRead << "，写回字节: " << stats.bytesWrittenBack << std::endl;
+    const char* names[] = {"read", "write", "flush"};
+    for (unsigned op = 0; op < LATENCY_OP_COUNT; op++) {
+        const LatencyHistogram& histogram = stats.latency[op];
+        std::cout << "  " << names[op] << "：" << histogram.count << "次，平均 " << std::setprecision(0) << histogram.mean()
+                  << " ns，p50 " << histogram.percentile(0.5) << " ns，p99 " << histogram.percentile(0.99)
+                  << " ns，p999 " << histogram.percentile(0.999) << " ns" << std::endl;
+    }
+    std::cout << "关闭延迟直方图: " << std::setprecision(1) << withoutHistograms << " ns/op，开启: " << withHistograms << " ns/op" << std::endl;
+
+    size_t lines = 0;
+    std::string line, last;
+    std::ifstream dump(STATS_DUMP_FILE);
+    while (std::getline(dump, line)) {
+        lines++;
+        last = line;
+    }
+    std::cout << "定期输出 " << lines << " 行，最后一行: " << last.substr(0, 100) << "..." << std::endl;
+    std::remove(STATS_TEST_FILE);
+    std::remove(STATS_DUMP_FILE);
+}
+
+// 原实现的块索引：哈希表记录块在访问队列中的迭代器，每次命中把节点移到队首
+typedef struct ListBlockInfo{
+    size_t cacheBufferOffset;
+    size_t blockValidSize;
+    std::list<size_t>::iterator accessOrderIterator;
+}ListBlockInfo;
+
+// 对keys依次查找并更新LRU，返回每次命中的平均耗时(ns)
+template <typename Lookup>
+double timeLookups(const std::vector<size_t>& keys, Lookup lookup) {
+    size_t sum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t key : keys) {
+        sum += lookup(key);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    volatile size_t sink = sum; // 防止查找被优化掉
+    (void)sink;
+    return std::chrono::duration<double, std::nano>(end - start).count() / keys.size();
+}
+
+void testBlockIndex() {
+    const size_t sizes[] = {1024, 64 * 1024, 1024 * 1024};
+    std::cout << "块索引命中开销（随机命中" << BLOCK_INDEX_LOOKUPS << "次，ns/次）：" << std::endl;
+    std::cout << std::setw(10) << "槽数" << std::setw(26) << "unordered_map+list" << std::setw(26) << "unordered_map+SlotLists"
+              << std::setw(24) << "BlockTable+SlotLists" << std::endl;
+    for (size_t numSlots : sizes) {
+        const size_t fh = 3;
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> dist(0, numSlots - 1);
+        std::vector<size_t> keys(BLOCK_INDEX_LOOKUPS);
+        for (size_t& key : keys) {
+            key = (fh << 48) | dist(rng); // 与缓存相同的块键(句柄, 块号)
+        }
+
+        double listNs;
+        {
+            std::unordered_map<size_t, ListBlockInfo> cache;
+            std::list<size_t> accessOrder;
+            for (size_t i = 0; i < numSlots; i++) {
+                size_t key = (fh << 48) | i;
+                accessOrder.push_front(key);
+                cache[key] = {i * 4096, 4096, accessOrder.begin()};
+            }
+            listNs = timeLookups(keys, [&](size_t key) {
+                ListBlockInfo& info = cache.find(key)->second;
+                accessOrder.erase(info.accessOrderIterator);
+                accessOrder.push_front(key);
+                info.accessOrderIterator = accessOrder.begin();
+                return info.cacheBufferOffset;
+            });
+        }
+
+        double mapNs;
+        {
+            std::unordered_map<size_t, size_t> index;
+            index.reserve(numSlots);
+            LruPolicy policy(numSlots);
+            std::vector<size_t> offsets(numSlots);
+            for (size_t i = 0; i < numSlots; i++) {
+                index[(fh << 48) | i] = i;
+                policy.onInsert(i, (fh << 48) | i);
+                offsets[i] = i * 4096;
+            }
+            mapNs = timeLookups(keys, [&](size_t key) {
+                size_t slot = index.find(key)->second;
+                policy.onAccess(slot);
+                return offsets[slot];
+            });
+        }
+
+        double tableNs;
+        {
+            BlockTable index;
+            index.reserve(numSlots);
+            LruPolicy policy(numSlots);
+            std::vector<size_t> offsets(numSlots);
+            for (size_t i = 0; i < numSlots; i++) {
+                index.insert((fh << 48) | i, i);
+                policy.onInsert(i, (fh << 48) | i);
+                offsets[i] = i * 4096;
+            }
+            tableNs = timeLookups(keys, [&](size_t key) {
+                size_t slot = index.find(key);
+                policy.onAccess(slot);
+                return offsets[slot];
+            });
+        }
+
+        std::cout << std::setw(10) << numSlots << std::fixed << std::setprecision(1) << std::setw(20) << listNs
+                  << std::setw(26) << mapNs << std::setw(24) << tableNs << std::endl;
+    }
+}
+
+// 用一种后端读写：顺序扫描、随机4KB读取、追加写入后flush，返回读到数据的校验和
+unsigned long runBackend(unsigned flags, const char* name) {
+    CacheConfig config;
+    config.cacheSize = 2 * MMAP_FILE_SIZE;
+    config.readahead = false;
+    CachedFileOperator cfo(config);
+    std::vector<char> buffer(1024 * 1024);
+    unsigned long sum = 0;
+
+    int fh = cfo.open(MMAP_TEST_FILE, flags | OPEN_SEQUENTIAL);
+    for (size_t off = 0; off < MMAP_FILE_SIZE; off += buffer.size()) { // 预热，使整个文件进入缓存或页缓存
+        cfo.pread(fh, buffer.data(), buffer.size(), off);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < MMAP_SCAN_REPEAT; r++) {
+        cfo.lseek(fh, 0, SEEK_SET);
+        for (size_t off = 0; off < MMAP_FILE_SIZE; off += buffer.size()) {
+            cfo.read(fh, buffer.data(), buffer.size());
+            sum += (unsigned char)buffer[off % buffer.size()];
+        }
+    }
+    auto scanned = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+
+    fh = cfo.open(MMAP_TEST_FILE, flags | OPEN_RANDOM);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, MMAP_FILE_SIZE / 4096 - 1);
+    auto randomStart = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < MMAP_RANDOM_OPS; ++i) {
+        cfo.pread(fh, buffer.data(), 4096, dist(rng) * 4096);
+        sum += (unsigned char)buffer[i % 4096];
+    }
+    auto randomEnd = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+
+    fh = cfo.open(MMAP_WRITE_TEST_FILE, flags);
+    fillRandomData(buffer.data(), MMAP_APPEND_SIZE);
+    auto appendStart = std::chrono::high_resolution_clock::now();
+    for (size_t off = 0; off < MMAP_FILE_SIZE; off += MMAP_APPEND_SIZE) {
+        cfo.write(fh, buffer.data(), MMAP_APPEND_SIZE);
+    }
+    cfo.flush(fh);
+    auto appendEnd = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+    struct stat st;
+    stat(MMAP_WRITE_TEST_FILE, &st);
+    std::remove(MMAP_WRITE_TEST_FILE);
+
+    double scanMB = (double)MMAP_FILE_SIZE * MMAP_SCAN_REPEAT / (1024.0 * 1024.0);
+    std::cout << std::setw(8) << name << std::fixed << std::setprecision(1)
+              << std::setw(16) << scanMB / std::chrono::duration<double>(scanned - start).count()
+              << std::setw(16) << std::chrono::duration<double, std::nano>(randomEnd - randomStart).count() / MMAP_RANDOM_OPS
+              << std::setw(16) << MMAP_FILE_SIZE / (1024.0 * 1024.0) / std::chrono::duration<double>(appendEnd - appendStart).count()
+              << (static_cast<size_t>(st.st_size) == MMAP_FILE_SIZE ? "" : "  追加后文件大小错误！") << std::endl;
+    return sum;
+}
+
+void testMappedFiles() {
+    std::vector<char> data(MMAP_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(MMAP_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data.data(), data.size());
+    close(fd);
+
+    std::cout << "映射文件测试（" << MMAP_FILE_SIZE / (1024 * 1024) << "MB，顺序扫描" << MMAP_SCAN_REPEAT << "次，随机4KB读取" << MMAP_RANDOM_OPS
+              << "次，" << MMAP_APPEND_SIZE / 1024 << "KB追加写入）：" << std::endl;
+    std::cout << std::setw(8) << "后端" << std::setw(18) << "扫描(MB/s)" << std::setw(16) << "随机(ns)" << std::setw(18) << "追加(MB/s)" << std::endl;
+    unsigned long cachedSum = runBackend(OPEN_DEFAULT, "cache");
+    unsigned long mappedSum = runBackend(OPEN_MMAP, "mmap");
+    std::remove(MMAP_TEST_FILE);
+    std::cout << (cachedSum == mappedSum ? "两种后端读到的数据一致。" : "两种后端读到的数据不一致！") << std::endl;
+}
+
+// 崩溃测试中第i次写入的偏移量、长度与数据，子进程与父进程用同一种子生成
+void journalCrashWrite(std::mt19937& rng, std::vector<char>& data, size_t& offset) {
+    std::uniform_int_distribution<size_t> sizeDist(1, 16 * 1024);
+    data.resize(sizeDist(rng));
+    std::uniform_int_distribution<size_t> offsetDist(0, JOURNAL_FILE_SIZE - data.size());
+    offset = offsetDist(rng);
+    for (char& c : data) {
+        c = 'a' + rng() % 26;
+    }
+}
+
+// 子进程写入后被SIGKILL杀死（不调用flush），检查下次open()重放日志后数据完整
+bool testJournalRecovery() {
+    int fd = open(JOURNAL_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, JOURNAL_FILE_SIZE);
+    close(fd);
+    std::remove(JOURNAL_TEST_FILE ".journal");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        CachedFileOperator cfo;
+        int fh = cfo.open(JOURNAL_TEST_FILE, OPEN_JOURNAL);
+        std::mt19937 rng(7);
+        std::vector<char> data;
+        size_t offset;
+        for (int i = 0; i < JOURNAL_CRASH_WRITES; i++) {
+            journalCrashWrite(rng, data, offset);
+            cfo.pwrite(fh, data.data(), data.size(), offset);
+        }
+        kill(getpid(), SIGKILL); // 模拟kill -9：缓存中的脏块全部丢失
+    }
+    int status;
+    waitpid(pid, &status, 0);
+
+    std::vector<char> expected(JOURNAL_FILE_SIZE, 0);
+    std::mt19937 rng(7);
+    std::vector<char> data;
+    size_t offset;
+    for (int i = 0; i < JOURNAL_CRASH_WRITES; i++) {
+        journalCrashWrite(rng, data, offset);
+        memcpy(expected.data() + offset, data.data(), data.size());
+    }
+
+    std::vector<char> actual(JOURNAL_FILE_SIZE);
+    fd = open(JOURNAL_TEST_FILE, O_RDONLY);
+    read(fd, actual.data(), actual.size());
+    close(fd);
+    size_t lostBytes = 0;
+    for (size_t i = 0; i < actual.size(); i++) {
+        lostBytes += actual[i] != expected[i];
+    }
+
+    CachedFileOperator cfo;
+    int fh = cfo.open(JOURNAL_TEST_FILE, OPEN_JOURNAL); // 重放日志
+    cfo.pread(fh, actual.data(), actual.size(), 0);
+    cfo.close(fh);
+    bool recovered = actual == expected;
+    bool journalRemoved = access(JOURNAL_TEST_FILE ".journal", F_OK) != 0; // 正常关闭后日志被删除
+    std::remove(JOURNAL_TEST_FILE);
+    std::cout << "日志崩溃恢复测试：子进程写入" << JOURNAL_CRASH_WRITES << "次后被SIGKILL，数据文件中缺失 " << lostBytes
+              << " 字节，重放后" << (recovered ? "完整" : "不完整") << std::endl;
+    return WIFSIGNALED(status) && recovered && journalRemoved;
+}
+
+// 子进程写入后打洞，随后被SIGKILL杀死（打洞后没有新的写入），检查下次open()重放日志后空洞仍读到0
+bool testJournalPunchHole() {
+    int fd = open(JOURNAL_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, JOURNAL_FILE_SIZE);
+    close(fd);
+    std::remove(JOURNAL_TEST_FILE ".journal");
+    std::vector<char> expected(JOURNAL_FILE_SIZE);
+    fillRandomData(expected.data(), expected.size());
+    size_t holeOffset = JOURNAL_FILE_SIZE / 4, holeSize = JOURNAL_FILE_SIZE / 2;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        CachedFileOperator cfo;
+        int fh = cfo.open(JOURNAL_TEST_FILE, OPEN_JOURNAL);
+        cfo.pwrite(fh, expected.data(), expected.size(), 0);
+        cfo.punchHole(fh, holeOffset, holeSize);
+        kill(getpid(), SIGKILL);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    memset(expected.data() + holeOffset, 0, holeSize);
+
+    std::vector<char> actual(JOURNAL_FILE_SIZE);
+    CachedFileOperator cfo;
+    int fh = cfo.open(JOURNAL_TEST_FILE, OPEN_JOURNAL); // 重放日志
+    cfo.pread(fh, actual.data(), actual.size(), 0);
+    cfo.close(fh);
+    std::remove(JOURNAL_TEST_FILE);
+    bool holeZero = std::all_of(actual.begin() + holeOffset, actual.begin() + holeOffset + holeSize, [](char c) { return c == 0; });
+    std::cout << "日志打洞恢复测试：打洞后被SIGKILL，重放后空洞" << (holeZero ? "仍为0" : "被旧数据覆盖") << std::endl;
+    return WIFSIGNALED(status) && actual == expected;
+}
+
+// 每次写入返回时都已落盘：逐次pwrite + fdatasync 与 预写日志成组提交 的对比
+void testJournalThroughput() {
+    int fd = open(JOURNAL_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, JOURNAL_FILE_SIZE);
+    close(fd);
+    std::cout << "持久写入测试（4KB随机写入" << JOURNAL_OPS << "次，每次返回时已落盘）：" << std::endl;
+    std::cout << std::setw(10) << "线程数" << std::setw(26) << "pwrite+fdatasync(ops/s)" << std::setw(20) << "日志(ops/s)" << std::setw(18) << "写入/fdatasync" << std::endl;
+    for (int numThreads : {1, 4, 16}) {
+        auto run = [numThreads](std::function<void(const char*, size_t)> durableWrite) {
+            std::vector<std::thread> threads;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int t = 0; t < numThreads; ++t) {
+                threads.emplace_back([&durableWrite, numThreads, t]() {
+                    std::mt19937 rng(t);
+                    std::uniform_int_distribution<size_t> offsetDist(0, JOURNAL_FILE_SIZE / JOURNAL_IO_SIZE - 1);
+                    char buffer[JOURNAL_IO_SIZE];
+                    memset(buffer, 'a' + t, sizeof(buffer));
+                    for (int i = 0; i < JOURNAL_OPS / numThreads; ++i) {
+                        durableWrite(buffer, offsetDist(rng) * JOURNAL_IO_SIZE);
+                    }
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            return JOURNAL_OPS / std::chrono::duration<double>(end - start).count();
+        };
+
+        int rawFd = open(JOURNAL_TEST_FILE, O_RDWR);
+        double inPlace = run([rawFd](const char* data, size_t offset) {
+            pwrite(rawFd, data, JOURNAL_IO_SIZE, offset);
+            fdatasync(rawFd);
+        });
+        close(rawFd);
+
+        CachedFileOperator cfo;
+        int fh = cfo.open(JOURNAL_TEST_FILE, OPEN_JOURNAL);
+        double journaled = run([&cfo, fh](const char* data, size_t offset) {
+            cfo.pwrite(fh, data, JOURNAL_IO_SIZE, offset);
+        });
+        CacheStats stats = cfo.getStats();
+        cfo.close(fh);
+        std::cout << std::setw(10) << numThreads << std::fixed << std::setprecision(0) << std::setw(22) << inPlace << std::setw(18) << journaled
+                  << std::setw(16) << std::setprecision(1) << (double)JOURNAL_OPS / stats.journalSyncs << std::endl;
+    }
+    std::remove(JOURNAL_TEST_FILE);
+}
+
+// 整块随机写入（无需先读文件），缓存满后每次分配槽都要淘汰
+void runWritebackWorkload(bool background) {
+    CacheConfig config;
+    config.readahead = false;
+    config.backgroundWriteback = background;
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(WRITEBACK_TEST_FILE);
+    std::vector<char> data(cfo.blockSize());
+    fillRandomData(data.data(), data.size());
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, WRITEBACK_FILE_SIZE / cfo.blockSize() - 1);
+    std::vector<double> latencies(WRITEBACK_OPS);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < WRITEBACK_OPS; ++i) {
+        auto opStart = std::chrono::high_resolution_clock::now();
+        cfo.pwrite(fh, data.data(), data.size(), dist(rng) * cfo.blockSize());
+        auto opEnd = std::chrono::high_resolution_clock::now();
+        latencies[i] = std::chrono::duration<double, std::nano>(opEnd - opStart).count();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    CacheStats stats = cfo.getStats();
+    cfo.close(fh);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::setw(8) << (background ? "开启" : "关闭") << std::fixed << std::setprecision(1)
+              << std::setw(12) << (double)WRITEBACK_OPS * cfo.blockSize() / (1024.0 * 1024.0) / std::chrono::duration<double>(end - start).count()
+              << std::setprecision(0) << std::setw(10) << percentile(latencies, 0.5) << std::setw(10) << percentile(latencies, 0.99)
+              << std::setw(10) << percentile(latencies, 0.999) << std::setw(14) << stats.evictionWriteBacks << std::setw(10) << stats.writerThrottles << std::endl;
+}
+
+void testBackgroundWriteback() {
+    int fd = open(WRITEBACK_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, WRITEBACK_FILE_SIZE);
+    close(fd);
+    std::cout << "后台写回测试（缓存64MB，在" << WRITEBACK_FILE_SIZE / (1024 * 1024) << "MB范围内整块随机写入" << WRITEBACK_OPS << "次）：" << std::endl;
+    std::cout << std::setw(10) << "后台写回" << std::setw(12) << "MB/s" << std::setw(10) << "p50(ns)" << std::setw(10) << "p99(ns)"
+              << std::setw(11) << "p999(ns)" << std::setw(16) << "前台写回块数" << std::setw(12) << "限速次数" << std::endl;
+    runWritebackWorkload(false);
+    runWritebackWorkload(true);
+    std::remove(WRITEBACK_TEST_FILE);
+}
+
+// 逐字段write()/read()或每条记录一次writev()/readv()，返回写入和读取每条记录的平均耗时（ns）
+std::pair<double, double> runRecordWorkload(bool vectored, const std::vector<char>& fields, std::vector<char>& readBack) {
+    CacheConfig config;
+    config.readahead = false;
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(VECTORED_TEST_FILE);
+    const size_t recordSize = VECTORED_FIELDS * VECTORED_FIELD_SIZE;
+    struct iovec iov[VECTORED_FIELDS];
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < VECTORED_RECORDS; ++r) {
+        const char* record = fields.data() + (r % 256) * recordSize; // 字段数据循环使用
+        if (vectored) {
+            for (int f = 0; f < VECTORED_FIELDS; ++f) {
+                iov[f] = {const_cast<char*>(record + f * VECTORED_FIELD_SIZE), VECTORED_FIELD_SIZE};
+            }
+            cfo.writev(fh, iov, VECTORED_FIELDS);
+        } else {
+            for (int f = 0; f < VECTORED_FIELDS; ++f) {
+                cfo.write(fh, record + f * VECTORED_FIELD_SIZE, VECTORED_FIELD_SIZE);
+            }
+        }
+    }
+    auto written = std::chrono::high_resolution_clock::now();
+
+    cfo.lseek(fh, 0, SEEK_SET);
+    for (int r = 0; r < VECTORED_RECORDS; ++r) {
+        char* record = readBack.data() + r * recordSize;
+        if (vectored) {
+            for (int f = 0; f < VECTORED_FIELDS; ++f) {
+                iov[f] = {record + f * VECTORED_FIELD_SIZE, VECTORED_FIELD_SIZE};
+            }
+            cfo.readv(fh, iov, VECTORED_FIELDS);
+        } else {
+            for (int f = 0; f < VECTORED_FIELDS; ++f) {
+                cfo.read(fh, record + f * VECTORED_FIELD_SIZE, VECTORED_FIELD_SIZE);
+            }
+        }
+    }
+    auto read = std::chrono::high_resolution_clock::now();
+    cfo.close(fh);
+    std::remove(VECTORED_TEST_FILE);
+    return {std::chrono::duration<double, std::nano>(written - start).count() / VECTORED_RECORDS,
+            std::chrono::duration<double, std::nano>(read - written).count() / VECTORED_RECORDS};
+}
+
+// 乱序的分散写入：每条记录的各字段以逆序提交，且与前一条记录共用块，检查pwritev()/preadv()的结果与逐个pwrite()一致
+bool testScatteredSegments() {
+    CachedFileOperator cfo;
+    int fh = cfo.open(VECTORED_TEST_FILE);
+    std::vector<char> data(VECTORED_FIELDS * VECTORED_FIELD_SIZE * 2);
+    std::vector<char> expected(1024 * 1024, 0), actual(expected.size());
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> dist(0, expected.size() - data.size());
+    IoSegment segments[VECTORED_FIELDS];
+    for (int r = 0; r < 1000; ++r) {
+        fillRandomData(data.data(), data.size());
+        for (int f = 0; f < VECTORED_FIELDS; ++f) { // 各段可能重叠，后面的段覆盖前面的
+            size_t length = VECTORED_FIELD_SIZE * (1 + f % 2);
+            size_t offset = dist(rng);
+            segments[VECTORED_FIELDS - 1 - f] = {static_cast<off_t>(offset), data.data() + f * VECTORED_FIELD_SIZE, length};
+        }
+        for (int f = 0; f < VECTORED_FIELDS; ++f) {
+            memcpy(expected.data() + segments[f].offset, segments[f].buffer, segments[f].length);
+        }
+        cfo.pwritev(fh, segments, VECTORED_FIELDS);
+    }
+    IoSegment whole[2] = {{static_cast<off_t>(expected.size() / 2), actual.data() + expected.size() / 2, expected.size() / 2},
+                          {0, actual.data(), expected.size() / 2}};
+    cfo.preadv(fh, whole, 2);
+    cfo.close(fh);
+    bool ok = actual == expected;
+    std::ifstream file(VECTORED_TEST_FILE, std::ios::binary);
+    std::vector<char> onDisk((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    onDisk.resize(expected.size(), 0);
+    std::remove(VECTORED_TEST_FILE);
+    return ok && onDisk == expected;
+}
+
+void testVectoredIo() {
+    const size_t recordSize = VECTORED_FIELDS * VECTORED_FIELD_SIZE;
+    std::vector<char> fields(256 * recordSize);
+    fillRandomData(fields.data(), fields.size());
+    std::vector<char> loopData(VECTORED_RECORDS * recordSize), vectoredData(VECTORED_RECORDS * recordSize);
+    std::pair<double, double> loop = runRecordWorkload(false, fields, loopData);
+    std::pair<double, double> vectored = runRecordWorkload(true, fields, vectoredData);
+
+    std::cout << "分散/集中读写测试（" << VECTORED_RECORDS << "条记录，每条" << VECTORED_FIELDS << "个" << VECTORED_FIELD_SIZE << "字节的字段）：" << std::endl;
+    std::cout << std::setw(14) << "方式" << std::setw(18) << "写入(ns/条)" << std::setw(18) << "读取(ns/条)" << std::endl;
+    std::cout << std::fixed << std::setprecision(0)
+              << std::setw(14) << "write()循环" << std::setw(14) << loop.first << std::setw(14) << loop.second << std::endl
+              << std::setw(14) << "writev()" << std::setw(14) << vectored.first << std::setw(14) << vectored.second << std::endl;
+    std::cout << (loopData == vectoredData ? "两种方式读到的数据一致。" : "两种方式读到的数据不一致！") << std::endl;
+    std::cout << (testScatteredSegments() ? "乱序分散写入测试通过。" : "乱序分散写入测试失败！") << std::endl;
+}
+
+// 生成类似服务日志的文本：递增的时间戳、少数几种级别与消息模板、随机的id与数值
+void fillText(char* data, size_t size, std::mt19937& rng) {
+    static const char* levels[] = {"INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR"};
+    static const char* paths[] = {"/api/v1/items", "/api/v1/users", "/api/v1/orders", "/static/app.js", "/healthz"};
+    static const char* users[] = {"alice", "bob", "carol", "dave", "eve", "mallory", "trent"};
+    std::uniform_int_distribution<int> pick(0, 1 << 20);
+    static long timestamp = 0; // 毫秒，多次调用之间继续递增
+    size_t pos = 0;
+    char line[256];
+    while (pos < size) {
+        timestamp += pick(rng) % 50;
+        int n = snprintf(line, sizeof(line), "2026-10-18 %02ld:%02ld:%02ld.%03ld %s [worker-%d] request id=%d user=%s path=%s status=%d latency_ms=%d\n",
+                         timestamp / 3600000 % 24, timestamp / 60000 % 60, timestamp / 1000 % 60, timestamp % 1000, levels[pick(rng) % 6],
+                         pick(rng) % 16, pick(rng), users[pick(rng) % 7], paths[pick(rng) % 5], pick(rng) % 10 ? 200 : 404, pick(rng) % 500);
+        size_t length = std::min(static_cast<size_t>(n), size - pos);
+        memcpy(data + pos, line, length);
+        pos += length;
+    }
+}
+
+// 在文本文件上随机读写整块，每次读取都与参考数据比较；结束后检查文件内容，返回是否一致
+bool runTierWorkload(size_t tierSize, const std::vector<char>& original) {
+    std::vector<char> reference = original;
+    int fd = open(TIER_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, reference.data(), reference.size());
+    close(fd);
+
+    CacheConfig config;
+    config.readahead = false;
+    config.compressedTierSize = tierSize;
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(TIER_TEST_FILE, OPEN_DIRECT | OPEN_RANDOM);
+    size_t blockSize = cfo.blockSize();
+    std::vector<char> buffer(blockSize);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> dist(0, TIER_FILE_SIZE / blockSize - 1);
+    bool ok = true;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < TIER_OPS; ++i) {
+        size_t offset = dist(rng) * blockSize;
+        if (i % 8 == 7) { // 改写块开头的一段，块仍然是可压缩的文本
+            fillText(reference.data() + offset, 256, rng);
+            cfo.pwrite(fh, reference.data() + offset, 256, offset);
+        } else {
+            cfo.pread(fh, buffer.data(), blockSize, offset);
+            ok &= memcmp(buffer.data(), reference.data() + offset, blockSize) == 0;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    CacheStats stats = cfo.getStats();
+    cfo.close(fh);
+
+    std::cout << std::setw(10) << tierSize / (1024 * 1024) << std::fixed << std::setprecision(1)
+              << std::setw(10) << stats.hitRatio() * 100 << std::setw(12) << (double)(stats.hits + stats.tierHits) / (stats.hits + stats.misses) * 100
+              << std::setw(14) << stats.bytesRead / (1024.0 * 1024.0) << std::setw(12) << stats.compressionRatio()
+              << std::setw(10) << stats.tierBypasses
+              << std::setprecision(0) << std::setw(12) << std::chrono::duration<double, std::micro>(end - start).count() / TIER_OPS << std::endl;
+
+    std::ifstream file(TIER_TEST_FILE, std::ios::binary); // 写入的块经过淘汰、写回、压缩、解压后，文件内容仍与参考数据一致
+    std::vector<char> onDisk((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(TIER_TEST_FILE);
+    return ok && onDisk == reference;
+}
+
+bool testCompressedTier() {
+    std::vector<char> original(TIER_FILE_SIZE);
+    std::mt19937 rng(1);
+    fillText(original.data(), original.size(), rng);
+
+    std::cout << "压缩二级缓存测试（主缓存64MB，" << TIER_FILE_SIZE / (1024 * 1024) << "MB文本文件，O_DIRECT随机访问整块" << TIER_OPS << "次）：" << std::endl;
+    std::cout << std::setw(12) << "二级(MB)" << std::setw(14) << "主命中率%" << std::setw(14) << "总命中率%" << std::setw(16) << "读文件(MB)"
+              << std::setw(12) << "压缩比" << std::setw(10) << "绕过" << std::setw(14) << "us/次" << std::endl;
+    bool ok = runTierWorkload(0, original);
+    ok &= runTierWorkload(TIER_SIZE, original);
+    return ok;
+}
+
+// 以O_DIRECT追加写入日志，返回MB/s；新块在文件数据上界之后，不应再读文件
+double runAppendLog(CacheStats& stats) {
+    CachedFileOperator cfo;
+    int fh = cfo.open(SPARSE_TEST_FILE, OPEN_DIRECT);
+    std::vector<char> record(SPARSE_RECORD_SIZE);
+    fillRandomData(record.data(), record.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t written = 0; written < SPARSE_APPEND_SIZE; written += record.size()) {
+        cfo.write(fh, record.data(), record.size());
+    }
+    cfo.flush(fh);
+    auto end = std::chrono::high_resolution_clock::now();
+    stats = cfo.getStats();
+    cfo.close(fh);
+    return SPARSE_APPEND_SIZE / (1024.0 * 1024.0) / std::chrono::duration<double>(end - start).count();
+}
+
+// 读取整个文件并与expected比较
+bool readWholeFile(CachedFileOperator& cfo, int fh, const std::vector<char>& expected) {
+    std::vector<char> buffer(1024 * 1024);
+    for (size_t offset = 0; offset < expected.size(); offset += buffer.size()) {
+        size_t size = std::min(buffer.size(), expected.size() - offset);
+        cfo.pread(fh, buffer.data(), size, offset);
+        if (memcmp(buffer.data(), expected.data() + offset, size) != 0) return false;
+    }
+    return true;
+}
+
+bool testSparseFiles() {
+    bool ok = true;
+    std::remove(SPARSE_TEST_FILE);
+    CacheStats stats;
+    double appendMBs = runAppendLog(stats);
+    std::cout << "稀疏文件测试：" << std::endl;
+    std::cout << "  追加写入" << SPARSE_APPEND_SIZE / (1024 * 1024) << "MB（每次" << SPARSE_RECORD_SIZE / 1024 << "KB，O_DIRECT）："
+              << std::fixed << std::setprecision(1) << appendMBs << " MB/s，读文件" << stats.readCalls << "次，直接填0的块" << stats.zeroFills << std::endl;
+    ok &= stats.readCalls == 0;
+
+    // 只在开头和中间各有一段数据的稀疏文件：打开时查出空洞，空洞中的块不读文件
+    std::vector<char> expected(SPARSE_FILE_SIZE, 0);
+    fillRandomData(expected.data(), 1024 * 1024);
+    fillRandomData(expected.data() + SPARSE_FILE_SIZE / 2, 1024 * 1024);
+    int fd = open(SPARSE_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    ftruncate(fd, SPARSE_FILE_SIZE);
+    pwrite(fd, expected.data(), 1024 * 1024, 0);
+    pwrite(fd, expected.data() + SPARSE_FILE_SIZE / 2, 1024 * 1024, SPARSE_FILE_SIZE / 2);
+    close(fd);
+    {
+        CachedFileOperator cfo;
+        int fh = cfo.open(SPARSE_TEST_FILE, OPEN_DIRECT);
+        auto start = std::chrono::high_resolution_clock::now();
+        ok &= readWholeFile(cfo, fh, expected);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::vector<char> buffer(1024 * 1024, 1);
+        cfo.pread(fh, buffer.data(), buffer.size(), SPARSE_FILE_SIZE - 4096); // 跨过文件末尾
+        ok &= std::all_of(buffer.begin(), buffer.end(), [](char c) { return c == 0; });
+        stats = cfo.getStats();
+        cfo.close(fh);
+        std::cout << "  读取" << SPARSE_FILE_SIZE / (1024 * 1024) << "MB稀疏文件（2MB数据）：" << std::setprecision(1)
+                  << SPARSE_FILE_SIZE / (1024.0 * 1024.0) / std::chrono::duration<double>(end - start).count() << " MB/s，读文件"
+                  << stats.bytesRead / (1024.0 * 1024.0) << "MB，直接填0的块" << stats.zeroFills << "，文件末尾之后" << stats.bytesPastEof << "字节" << std::endl;
+        ok &= stats.bytesRead <= 4 * 1024 * 1024;
+    }
+
+    // 打洞：缓存中的数据与文件都变为0，文件占用的空间减少；打洞后再写入空洞，数据不丢失
+    struct stat before, after;
+    stat(SPARSE_TEST_FILE, &before);
+    {
+        CachedFileOperator cfo;
+        int fh = cfo.open(SPARSE_TEST_FILE);
+        readWholeFile(cfo, fh, expected); // 使数据进入缓存
+        cfo.punchHole(fh, 100, SPARSE_FILE_SIZE / 2 + 512 * 1024 - 100);
+        memset(expected.data() + 100, 0, SPARSE_FILE_SIZE / 2 + 512 * 1024 - 100);
+        ok &= readWholeFile(cfo, fh, expected);
+        cfo.flush(fh);
+        stat(SPARSE_TEST_FILE, &after);
+        fillRandomData(expected.data() + SPARSE_FILE_SIZE / 4, 8192);
+        cfo.pwrite(fh, expected.data() + SPARSE_FILE_SIZE / 4, 8192, SPARSE_FILE_SIZE / 4);
+        cfo.preallocate(fh, SPARSE_FILE_SIZE, 4 * 1024 * 1024); // 扩展文件，新部分读到0
+        expected.resize(SPARSE_FILE_SIZE + 4 * 1024 * 1024, 0);
+        cfo.resize(4 * 1024 * 1024); // 缩小缓存，迫使写入的块被淘汰后重新读入
+        cfo.resize(64 * 1024 * 1024);
+        ok &= readWholeFile(cfo, fh, expected);
+        cfo.close(fh);
+    }
+    std::ifstream file(SPARSE_TEST_FILE, std::ios::binary);
+    std::vector<char> onDisk((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ok &= onDisk == expected;
+    std::cout << "  打洞后文件占用：" << before.st_blocks * 512 / 1024 << "KB -> " << after.st_blocks * 512 / 1024 << "KB" << std::endl;
+    std::remove(SPARSE_TEST_FILE);
+    return ok;
+}
+
+// Zipf分布的取样：预先计算累积分布，二分查找；排名乘一个与n互质的数打散到整个文件，热点不集中在开头
+class ZipfGenerator {
+public:
+    ZipfGenerator(size_t n, double theta, uint64_t seed) : m_cdf(n), m_rng(seed) {
+        double sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            sum += 1.0 / std::pow(static_cast<double>(i + 1), theta);
+            m_cdf[i] = sum;
+        }
+        for (double& c : m_cdf) c /= sum;
+    }
+    size_t next() {
+        size_t rank = std::lower_bound(m_cdf.begin(), m_cdf.end(), m_uniform(m_rng)) - m_cdf.begin();
+        rank = std::min(rank, m_cdf.size() - 1);
+        return static_cast<size_t>(rank * 1000003ULL % m_cdf.size()); // 1000003是质数
+    }
+private:
+    std::vector<double> m_cdf;
+    std::mt19937_64 m_rng;
+    std::uniform_real_distribution<double> m_uniform{0.0, 1.0};
+};
+
+// 生成的跟踪每个操作间隔1us
+TraceRecord traceRecord(size_t index, TraceOp op, uint64_t offset, size_t size) {
+    return {index * 1000, offset, static_cast<uint32_t>(size), 0, op, 0};
+}
+
+// Zipf分布的4KB随机读写，readPercent%为读取
+std::vector<TraceRecord> generateZipfTrace(int readPercent) {
+    ZipfGenerator zipf(TRACE_FILE_SIZE / TRACE_IO_SIZE, TRACE_ZIPF_THETA, 42);
+    std::mt19937 rng(7);
+    std::vector<TraceRecord> trace;
+    for (size_t i = 0; i < TRACE_OPS; i++) {
+        TraceOp op = static_cast<int>(rng() % 100) < readPercent ? TRACE_READ : TRACE_WRITE;
+        trace.push_back(traceRecord(i, op, zipf.next() * TRACE_IO_SIZE, TRACE_IO_SIZE));
+    }
+    return trace;
+}
+
+// 反复顺序扫描整个文件
+std::vector<TraceRecord> generateScanTrace() {
+    std::vector<TraceRecord> trace;
+    for (int pass = 0; pass < TRACE_SCAN_PASSES; pass++) {
+        for (size_t offset = 0; offset < TRACE_FILE_SIZE; offset += TRACE_SCAN_SIZE) {
+            trace.push_back(traceRecord(trace.size(), TRACE_READ, offset, TRACE_SCAN_SIZE));
+        }
+    }
+    return trace;
+}
+
+// 混合负载：70% Zipf读、20% Zipf写、10%继续一次顺序扫描，每10000个操作flush一次
+std::vector<TraceRecord> generateMixedTrace() {
+    ZipfGenerator zipf(TRACE_FILE_SIZE / TRACE_IO_SIZE, TRACE_ZIPF_THETA, 43);
+    std::mt19937 rng(8);
+    std::vector<TraceRecord> trace;
+    size_t scanOffset = 0;
+    for (size_t i = 0; i < TRACE_OPS; i++) {
+        int dice = rng() % 100;
+        if (i % 10000 == 9999) {
+            trace.push_back(traceRecord(i, TRACE_FLUSH, 0, 0));
+        } else if (dice < 70) {
+            trace.push_back(traceRecord(i, TRACE_READ, zipf.next() * TRACE_IO_SIZE, TRACE_IO_SIZE));
+        } else if (dice < 90) {
+            trace.push_back(traceRecord(i, TRACE_WRITE, zipf.next() * TRACE_IO_SIZE, TRACE_IO_SIZE));
+        } else {
+            trace.push_back(traceRecord(i, TRACE_READ, scanOffset, TRACE_SCAN_SIZE));
+            scanOffset = (scanOffset + TRACE_SCAN_SIZE) % TRACE_FILE_SIZE;
+        }
+    }
+    return trace;
+}
+
+void writeTrace(const std::string& path, const std::vector<TraceRecord>& trace) {
+    TraceWriter writer(path);
+    for (const TraceRecord& record : trace) writer.append(record);
+    writer.close();
+}
+
+typedef struct ReplayResult{
+    double seconds; //重放耗时
+    size_t bytes; //读写的字节数
+    std::vector<double> latencies; //每个操作的延迟（ns）
+    CacheStats stats; //缓存统计
+}ReplayResult;
+
+// 按给定配置尽快重放跟踪（不按时间戳等待），跟踪中的所有句柄都映射到同一个数据文件，以O_DIRECT打开使未命中真正读设备
+ReplayResult replayTrace(const std::vector<TraceRecord>& trace, const CacheConfig& config) {
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(TRACE_DATA_FILE, OPEN_DIRECT);
+    std::vector<char> buffer(TRACE_SCAN_SIZE);
+    fillRandomData(buffer.data(), buffer.size());
+    ReplayResult result;
+    result.bytes = 0;
+    result.latencies.reserve(trace.size());
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const TraceRecord& record : trace) {
+        if (record.size > buffer.size()) buffer.resize(record.size);
+        auto opStart = std::chrono::high_resolution_clock::now();
+        switch (record.op) {
+        case TRACE_READ:
+            cfo.pread(fh, buffer.data(), record.size, record.offset);
+            break;
+        case TRACE_WRITE:
+            cfo.pwrite(fh, buffer.data(), record.size, record.offset);
+            break;
+        case TRACE_FLUSH:
+            cfo.flush(fh);
+            break;
+        }
+        auto opEnd = std::chrono::high_resolution_clock::now();
+        result.latencies.push_back(std::chrono::duration<double, std::nano>(opEnd - opStart).count());
+        result.bytes += record.size;
+    }
+    cfo.flush(fh);
+    result.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    result.stats = cfo.getStats();
+    cfo.close(fh);
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+// 生成三种跟踪写入文件，再读回并在各淘汰策略下重放；最后检查重放时记录的跟踪与原跟踪一致
+bool testTraceReplay() {
+    std::vector<char> data(TRACE_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(TRACE_DATA_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data.data(), data.size());
+    close(fd);
+
+    const std::pair<const char*, std::vector<TraceRecord>> generated[] = {
+        {"zipf", generateZipfTrace(90)}, {"scan", generateScanTrace()}, {"mixed", generateMixedTrace()}
+    };
+    const EvictionPolicyType policies[] = {
+        EvictionPolicyType::LRU, EvictionPolicyType::CLOCK, EvictionPolicyType::TWO_Q, EvictionPolicyType::ARC
+    };
+    std::cout << "跟踪重放测试（文件" << TRACE_FILE_SIZE / (1024 * 1024) << "MB，缓存64MB，O_DIRECT）：" << std::endl;
+    std::cout << std::setw(8) << "跟踪" << std::setw(8) << "策略" << std::setw(12) << "ops/s" << std::setw(10) << "MB/s"
+              << std::setw(13) << "命中率%" << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)" << std::setw(11) << "p999(us)" << std::endl;
+    bool ok = true;
+    for (const auto& entry : generated) {
+        std::string path = std::string("trace_") + entry.first + ".bin";
+        writeTrace(path, entry.second);
+        std::vector<TraceRecord> trace = readTrace(path);
+        std::remove(path.c_str());
+        ok &= trace.size() == entry.second.size();
+        for (EvictionPolicyType policy : policies) {
+            CacheConfig config;
+            config.policy = policy;
+            config.readahead = false; // 只比较淘汰策略
+            ReplayResult result = replayTrace(trace, config);
+            std::cout << std::setw(8) << entry.first << std::setw(8) << evictionPolicyName(policy) << std::fixed << std::setprecision(0)
+                      << std::setw(12) << trace.size() / result.seconds << std::setprecision(1)
+                      << std::setw(10) << result.bytes / (1024.0 * 1024.0) / result.seconds << std::setw(10) << result.stats.hitRatio() * 100
+                      << std::setw(10) << percentile(result.latencies, 0.5) / 1000 << std::setw(10) << percentile(result.latencies, 0.99) / 1000
+                      << std::setw(10) << percentile(result.latencies, 0.999) / 1000 << std::endl;
+        }
+    }
+
+    // 从运行中的缓存记录跟踪
+    const std::vector<TraceRecord>& mixed = generated[2].second;
+    CacheConfig config;
+    config.tracePath = TRACE_RECORDED_FILE;
+    replayTrace(mixed, config);
+    std::vector<TraceRecord> recorded = readTrace(TRACE_RECORDED_FILE);
+    std::remove(TRACE_RECORDED_FILE);
+    std::remove(TRACE_DATA_FILE);
+    size_t matched = 0;
+    for (size_t i = 0; i < std::min(recorded.size(), mixed.size()); i++) {
+        matched += recorded[i].op == mixed[i].op && recorded[i].offset == mixed[i].offset && recorded[i].size == mixed[i].size;
+    }
+    // 记录的跟踪多出重放结束时的一次flush
+    std::cout << "记录的跟踪：" << recorded.size() << "个操作，与原跟踪一致的" << matched << "个，耗时"
+              << std::fixed << std::setprecision(1) << (recorded.empty() ? 0 : recorded.back().timestampNs / 1e6) << "ms" << std::endl;
+    return ok && matched == mixed.size() && recorded.size() == mixed.size() + 1;
+}
+
+// 在不同的块中随机读取ASYNC_OPS次（均未命中）：逐个pread()，或一次提交全部readAsync()再逐个等待。返回耗时（秒），ok为读到的数据是否正确
+double runAsyncReads(bool async, size_t workers, const std::vector<char>& data, bool& ok) {
+    CacheConfig config;
+    config.readahead = false; // 只比较读取能否重叠
+    config.asyncWorkers = workers;
+    CachedFileOperator cfo(config);
+    int fh = cfo.open(ASYNC_TEST_FILE, OPEN_DIRECT);
+    std::vector<size_t> blocks(ASYNC_FILE_SIZE / cfo.blockSize());
+    for (size_t i = 0; i < blocks.size(); i++) blocks[i] = i;
+    std::shuffle(blocks.begin(), blocks.end(), std::mt19937(11));
+    std::vector<off_t> offsets(ASYNC_OPS);
+    for (int i = 0; i < ASYNC_OPS; i++) {
+        offsets[i] = blocks[i] * cfo.blockSize() + (i % 16) * ASYNC_IO_SIZE;
+    }
+    std::vector<char> buffer(ASYNC_OPS * ASYNC_IO_SIZE);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (async) {
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < ASYNC_OPS; i++) {
+            futures.push_back(cfo.readAsync(fh, buffer.data() + i * ASYNC_IO_SIZE, ASYNC_IO_SIZE, offsets[i]));
+        }
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+    } else {
+        for (int i = 0; i < ASYNC_OPS; i++) {
+            cfo.pread(fh, buffer.data() + i * ASYNC_IO_SIZE, ASYNC_IO_SIZE, offsets[i]);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    cfo.close(fh);
+    ok = true;
+    for (int i = 0; i < ASYNC_OPS; i++) {
+        ok &= memcmp(buffer.data() + i * ASYNC_IO_SIZE, data.data() + offsets[i], ASYNC_IO_SIZE) == 0;
+    }
+    return seconds;
+}
+
+// 未命中的随机读取：同步逐个读取与不同工作线程数下的异步读取对比；再检查全部命中时在调用线程中完成，以及异步写入与flushAsync的结果
+bool testAsyncIo() {
+    std::vector<char> data(ASYNC_FILE_SIZE);
+    fillRandomData(data.data(), data.size());
+    int fd = open(ASYNC_TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    write(fd, data.data(), data.size());
+    fsync(fd); // 否则第一轮O_DIRECT读取要先等内核写回这些页
+    close(fd);
+
+    std::cout << "异步读写测试（文件" << ASYNC_FILE_SIZE / (1024 * 1024) << "MB，O_DIRECT，" << ASYNC_OPS << "次" << ASYNC_IO_SIZE
+              << "字节随机读取，每次都未命中）：" << std::endl;
+    std::cout << std::setw(16) << "方式" << std::setw(12) << "ops/s" << std::setw(10) << "us/op" << std::endl;
+    bool ok = true;
+    const std::pair<bool, size_t> modes[] = {{false, 0}, {true, 1}, {true, 4}, {true, 16}};
+    for (const auto& mode : modes) {
+        bool correct;
+        double seconds = runAsyncReads(mode.first, mode.second, data, correct);
+        ok &= correct;
+        std::string name = mode.first ? "readAsync x" + std::to_string(mode.second) : "pread";
+        std::cout << std::setw(16) << name << std::fixed << std::setprecision(0) << std::setw(12) << ASYNC_OPS / seconds
+                  << std::setprecision(1) << std::setw(10) << seconds * 1e6 / ASYNC_OPS << std::endl;
+    }
+
+    CachedFileOperator cfo;
+    int fh = cfo.open(ASYNC_TEST_FILE);
+    const size_t blockSize = cfo.blockSize();
+    std::vector<char> buffer(16 * blockSize);
+    cfo.pread(fh, buffer.data(), buffer.size(), 0); // 前16块已在缓存中
+    size_t ready = 0;
+    for (int i = 0; i < 16; i++) {
+        std::future<void> future = cfo.readAsync(fh, buffer.data() + i * blockSize, blockSize, i * blockSize);
+        ready += future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        future.get();
+    }
+    ok &= ready == 16 && memcmp(buffer.data(), data.data(), buffer.size()) == 0;
+
+    // 写入一部分在缓存中、一部分不在缓存中的块，用回调统计完成数
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t completed = 0, failed = 0;
+    std::vector<char> written(64 * ASYNC_IO_SIZE);
+    fillRandomData(written.data(), written.size());
+    for (int i = 0; i < 64; i++) {
+        off_t offset = i * 7 * blockSize + 100; // 块0、7、14在缓存中
+        memcpy(data.data() + offset, written.data() + i * ASYNC_IO_SIZE, ASYNC_IO_SIZE);
+        cfo.writeAsync(fh, written.data() + i * ASYNC_IO_SIZE, ASYNC_IO_SIZE, offset, [&](std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed++;
+            failed += error != nullptr;
+            cv.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return completed == 64; });
+    }
+    cfo.flushAsync(fh).get();
+    CacheStats stats = cfo.getStats();
+    cfo.close(fh);
+    std::ifstream file(ASYNC_TEST_FILE, std::ios::binary);
+    std::vector<char> onDisk((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(ASYNC_TEST_FILE);
+    std::cout << "全部命中时立即完成" << ready << "/16个读取；异步写入64次，调用线程中完成" << stats.asyncInline - ready
+              << "次，交给工作线程" << stats.asyncQueued - 1 << "次" << std::endl;
+    return ok && failed == 0 && onDisk == data;
 }
 
 int main() {
@@ -154,5 +1675,85 @@ int main() {
         std::cout << "文件内容不一致！" << std::endl; // 输出不一致性检查结果
     }
 
+    if (testMultipleFiles(OPEN_DEFAULT)) {
+        std::cout << "多文件测试通过。" << std::endl;
+    } else {
+        std::cout << "多文件测试失败！" << std::endl;
+    }
+
+    if (testMultipleFiles(OPEN_DIRECT)) {
+        std::cout << "O_DIRECT多文件测试通过。" << std::endl;
+    } else {
+        std::cout << "O_DIRECT多文件测试失败！" << std::endl;
+    }
+
+    testConcurrentScaling(); // 多线程扩展性测试
+
+    testEvictionPolicies(); // 淘汰策略对比
+
+    testSequentialReadahead(); // 顺序读取预读测试
+
+    testZeroCopyScan(); // 零拷贝读取测试
+
+    testIoEngines(); // I/O引擎对比
+
+    testBlockSizes(); // 块大小对比
+
+    if (testResize()) {
+        std::cout << "缓存大小调整测试通过。" << std::endl;
+    } else {
+        std::cout << "缓存大小调整测试失败！" << std::endl;
+    }
+
+    testHugePages(); // 大页对比
+
+    testStatistics(); // 统计与延迟直方图
+
+    testBlockIndex(); // 块索引结构对比
+
+    testMappedFiles(); // 块缓存与内存映射对比
+
+    if (testJournalRecovery()) {
+        std::cout << "日志崩溃恢复测试通过。" << std::endl;
+    } else {
+        std::cout << "日志崩溃恢复测试失败！" << std::endl;
+    }
+
+    if (testJournalPunchHole()) {
+        std::cout << "日志打洞恢复测试通过。" << std::endl;
+    } else {
+        std::cout << "日志打洞恢复测试失败！" << std::endl;
+    }
+
+    testJournalThroughput(); // 预写日志成组提交
+
+    testBackgroundWriteback(); // 后台写回与写入限速
+
+    testVectoredIo(); // 分散/集中读写
+
+    if (testCompressedTier()) {
+        std::cout << "压缩二级缓存测试通过。" << std::endl;
+    } else {
+        std::cout << "压缩二级缓存测试失败！" << std::endl;
+    }
+
+    if (testSparseFiles()) {
+        std::cout << "稀疏文件测试通过。" << std::endl;
+    } else {
+        std::cout << "稀疏文件测试失败！" << std::endl;
+    }
+
+    if (testTraceReplay()) {
+        std::cout << "跟踪重放测试通过。" << std::endl;
+    } else {
+        std::cout << "跟踪重放测试失败！" << std::endl;
+    }
+
+    if (testAsyncIo()) {
+        std::cout << "异步读写测试通过。" << std::endl;
+    } else {
+        std::cout << "异步读写测试失败！" << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "CompressedTier.h"
+#include "Lz4.h"
+#include <cstring>
+
+CompressedTier::CompressedTier(size_t capacity, size_t blockSize)
+    : m_capacity(capacity), m_blockSize(blockSize), m_log(new char[capacity]), m_scratch(new char[blockSize]), m_wrap(capacity) {
+    m_index.reserve(capacity / (blockSize / 8) + 1); // 按平均8倍压缩估计，超出时自动扩大
+}
+
+size_t CompressedTier::recordSize(size_t compressedSize) {
+    return (sizeof(RecordHeader) + compressedSize + 7) & ~static_cast<size_t>(7);
+}
+
+size_t CompressedTier::store(size_t key, const char* data, size_t size) {
+    size_t compressedSize = lz4Compress(data, size, m_scratch.get(), m_blockSize / 8 * 7);
+    if (compressedSize == 0 || recordSize(compressedSize) > m_capacity) {
+        m_index.erase(key); // 已有的记录是该块较旧的内容
+        return 0;
+    }
+    size_t offset = allocate(recordSize(compressedSize));
+    RecordHeader header = {key, static_cast<uint32_t>(compressedSize), static_cast<uint32_t>(size)};
+    memcpy(m_log.get() + offset, &header, sizeof(header));
+    memcpy(m_log.get() + offset + sizeof(header), m_scratch.get(), compressedSize);
+    m_index.insert(key, offset); // 替换已有的记录
+    return compressedSize;
+}
+
+ssize_t CompressedTier::load(size_t key, char* buffer) {
+    size_t offset = m_index.find(key);
+    if (offset == BlockTable::NOT_FOUND) return -1;
+    m_index.erase(key);
+    RecordHeader header;
+    memcpy(&header, m_log.get() + offset, sizeof(header));
+    if (!lz4Decompress(m_log.get() + offset + sizeof(header), header.compressedSize, buffer, header.dataSize)) {
+        return -1; // 不应发生；当作未命中，从文件读入
+    }
+    return header.dataSize;
+}
+
+size_t CompressedTier::allocate(size_t size) {
+    while (true) {
+        if (m_records == 0) {
+            m_head = m_tail = 0;
+            m_wrap = m_capacity;
+        }
+        if (m_records == 0 || m_head > m_tail) { // 未回绕：先用[m_head, m_capacity)，不够时回绕到开头
+            if (m_capacity - m_head >= size) break;
+            m_wrap = m_head;
+            m_head = 0;
+        }
+        if (m_tail - m_head >= size) break; // 已回绕：可用空间为[m_head, m_tail)
+        dropOldest();
+    }
+    size_t offset = m_head;
+    m_head += size;
+    m_records++;
+    return offset;
+}
+
+void CompressedTier::dropOldest() {
+    RecordHeader header;
+    memcpy(&header, m_log.get() + m_tail, sizeof(header));
+    if (m_index.find(header.key) == m_tail) { // 仍是该块的有效记录
+        m_index.erase(header.key);
+    }
+    m_tail += recordSize(header.compressedSize);
+    m_records--;
+    if (m_tail == m_wrap) {
+        m_tail = 0;
+        m_wrap = m_capacity;
+    }
+}
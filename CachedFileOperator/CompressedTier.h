@@ -0,0 +1,55 @@
+#ifndef CompressedTier_H
+#define CompressedTier_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sys/types.h>
+#include "BlockTable.h"
+
+/*
+压缩二级缓存：主缓存淘汰的块压缩后追加到一个环形日志区，之后该块未命中时先在这里查找，命中则解压而不必读文件。
+只存放干净块（淘汰时脏块已先写回），命中后即从本层移除，块回到主缓存，两层中不会同时有同一块。
+日志区满时从最早的记录开始覆盖（FIFO）；被取出或被替换的记录只从索引中删除，空间等到被覆盖时回收。
+压缩后超过块大小的7/8的块不存放（绕过），避免为不可压缩的数据浪费空间和解压时间。
+每个分片一个实例，由分片的锁保护。
+*/
+class CompressedTier {
+public:
+    CompressedTier(size_t capacity, size_t blockSize); // capacity：日志区大小
+    CompressedTier(const CompressedTier&) = delete;
+    CompressedTier& operator=(const CompressedTier&) = delete;
+
+    size_t store(size_t key, const char* data, size_t size); // 压缩并存入，返回压缩后的大小；绕过时返回0，并删除该块已有的记录
+    ssize_t load(size_t key, char* buffer); // 若存在则解压到buffer并移除，返回数据大小；不存在时返回-1
+    void erase(size_t key) { m_index.erase(key); } // 块在主缓存中被整块覆盖等，已有的记录作废
+    size_t size() const { return m_index.size(); } // 存放的块数
+
+    template <typename P>
+    void eraseIf(P pred) { // 删除所有键满足pred(key)的记录
+        m_index.eraseIf([&](size_t key, size_t) { return pred(key); });
+    }
+
+private:
+    typedef struct RecordHeader{
+        uint64_t key; //块键
+        uint32_t compressedSize; //压缩数据大小
+        uint32_t dataSize; //原始数据大小（文件末尾的块可能不足一块）
+    }RecordHeader;
+
+    static size_t recordSize(size_t compressedSize); // 记录大小，按8字节对齐
+    size_t allocate(size_t size); // 在日志区中分配size字节，必要时覆盖最早的记录，返回偏移量
+    void dropOldest(); // 回收最早的一条记录
+
+    size_t m_capacity;
+    size_t m_blockSize;
+    std::unique_ptr<char[]> m_log; // 环形日志区
+    std::unique_ptr<char[]> m_scratch; // 压缩时的临时缓冲区
+    BlockTable m_index; // 块键 -> 记录在日志区中的偏移量
+    // 有记录时：m_head > m_tail表示数据在[m_tail, m_head)；否则已回绕，数据在[m_tail, m_wrap)和[0, m_head)
+    size_t m_head = 0; // 下一条记录的位置
+    size_t m_tail = 0; // 最早一条记录的位置
+    size_t m_wrap = 0; // 回绕前最后一条记录的结束位置
+    size_t m_records = 0; // 日志区中的记录数（包括已作废的）
+};
+
+#endif // CompressedTier_H
@@ -0,0 +1,276 @@
+#include "EvictionPolicy.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::unique_ptr<EvictionPolicy> createEvictionPolicy(EvictionPolicyType type, size_t capacity) {
+    switch (type) {
+    case EvictionPolicyType::LRU:
+        return std::unique_ptr<EvictionPolicy>(new LruPolicy(capacity));
+    case EvictionPolicyType::CLOCK:
+        return std::unique_ptr<EvictionPolicy>(new ClockPolicy(capacity));
+    case EvictionPolicyType::TWO_Q:
+        return std::unique_ptr<EvictionPolicy>(new TwoQueuePolicy(capacity));
+    case EvictionPolicyType::ARC:
+        return std::unique_ptr<EvictionPolicy>(new ArcPolicy(capacity));
+    }
+    throw std::runtime_error("Unknown eviction policy");
+}
+
+const char* evictionPolicyName(EvictionPolicyType type) {
+    switch (type) {
+    case EvictionPolicyType::LRU: return "LRU";
+    case EvictionPolicyType::CLOCK: return "CLOCK";
+    case EvictionPolicyType::TWO_Q: return "2Q";
+    case EvictionPolicyType::ARC: return "ARC";
+    }
+    return "UNKNOWN";
+}
+
+size_t EvictionPolicy::lastUnpinned(const SlotLists& lists, size_t list) const {
+    size_t slot = lists.back(list);
+    while (slot != SlotLists::NONE && isPinned(slot)) {
+        slot = lists.previous(slot);
+    }
+    return slot;
+}
+
+/* ---------------- SlotLists ---------------- */
+
+const size_t SlotLists::NONE;
+
+SlotLists::SlotLists(size_t capacity, size_t numLists)
+    : m_capacity(capacity), m_prev(capacity + numLists), m_next(capacity + numLists),
+      m_listOf(capacity, NONE), m_sizes(numLists, 0) {
+    for (size_t i = 0; i < numLists; i++) { // 空链表的哨兵指向自己
+        m_prev[capacity + i] = m_next[capacity + i] = capacity + i;
+    }
+}
+
+void SlotLists::pushFront(size_t list, size_t slot) {
+    size_t head = m_capacity + list;
+    m_next[slot] = m_next[head];
+    m_prev[slot] = head;
+    m_prev[m_next[head]] = slot;
+    m_next[head] = slot;
+    m_listOf[slot] = list;
+    m_sizes[list]++;
+}
+
+void SlotLists::remove(size_t slot) {
+    if (m_listOf[slot] == NONE) return;
+    m_next[m_prev[slot]] = m_next[slot];
+    m_prev[m_next[slot]] = m_prev[slot];
+    m_sizes[m_listOf[slot]]--;
+    m_listOf[slot] = NONE;
+}
+
+size_t SlotLists::back(size_t list) const {
+    if (m_sizes[list] == 0) return NONE;
+    return m_prev[m_capacity + list];
+}
+
+size_t SlotLists::previous(size_t slot) const {
+    size_t prev = m_prev[slot];
+    return prev >= m_capacity ? NONE : prev; // 哨兵节点
+}
+
+/* ---------------- GhostList ---------------- */
+
+GhostList::GhostList(size_t capacity) : m_order(capacity, 1), m_keys(capacity) {
+    m_freeNodes.reserve(capacity);
+    for (size_t i = capacity; i > 0; i--) {
+        m_freeNodes.push_back(i - 1);
+    }
+    m_index.reserve(capacity);
+}
+
+void GhostList::pushFront(size_t key) {
+    erase(key);
+    if (m_freeNodes.empty()) {
+        popBack();
+    }
+    size_t node = m_freeNodes.back();
+    m_freeNodes.pop_back();
+    m_keys[node] = key;
+    m_order.pushFront(0, node);
+    m_index.insert(key, node);
+}
+
+bool GhostList::erase(size_t key) {
+    size_t node = m_index.find(key);
+    if (node == BlockTable::NOT_FOUND) return false;
+    m_order.remove(node);
+    m_index.erase(key);
+    m_freeNodes.push_back(node);
+    return true;
+}
+
+void GhostList::popBack() {
+    size_t node = m_order.back(0);
+    if (node == SlotLists::NONE) return;
+    erase(m_keys[node]);
+}
+
+/* ---------------- LRU ---------------- */
+
+LruPolicy::LruPolicy(size_t capacity) : EvictionPolicy(capacity), m_lists(capacity, 1) {
+}
+
+void LruPolicy::onInsert(size_t slot, size_t key) {
+    (void)key;
+    m_lists.pushFront(0, slot);
+}
+
+void LruPolicy::onAccess(size_t slot) {
+    m_lists.remove(slot);
+    m_lists.pushFront(0, slot);
+}
+
+void LruPolicy::onRemove(size_t slot) {
+    m_lists.remove(slot);
+}
+
+size_t LruPolicy::selectVictim() {
+    size_t victim = lastUnpinned(m_lists, 0);
+    if (victim == SlotLists::NONE) {
+        throw std::runtime_error("LRU: No block to evict");
+    }
+    m_lists.remove(victim);
+    return victim;
+}
+
+/* ---------------- CLOCK ---------------- */
+
+ClockPolicy::ClockPolicy(size_t capacity)
+    : EvictionPolicy(capacity), m_referenced(capacity, 0), m_used(capacity, 0), m_hand(0) {
+}
+
+void ClockPolicy::onInsert(size_t slot, size_t key) {
+    (void)key;
+    m_used[slot] = 1;
+    m_referenced[slot] = 0; // 新块需要再次访问才受保护，一次性扫描的块会被优先淘汰
+}
+
+void ClockPolicy::onAccess(size_t slot) {
+    m_referenced[slot] = 1;
+}
+
+void ClockPolicy::onRemove(size_t slot) {
+    m_used[slot] = 0;
+    m_referenced[slot] = 0;
+}
+
+size_t ClockPolicy::selectVictim() {
+    // 最多转两圈：第一圈清除所有访问位，第二圈必然找到访问位为0的槽
+    for (size_t i = 0; i < 2 * m_used.size(); i++) {
+        size_t slot = m_hand;
+        m_hand = (m_hand + 1) % m_used.size();
+        if (!m_used[slot] || isPinned(slot)) continue; // 被保护的槽保留访问位
+        if (m_referenced[slot]) {
+            m_referenced[slot] = 0; // 给予第二次机会
+            continue;
+        }
+        m_used[slot] = 0;
+        return slot;
+    }
+    throw std::runtime_error("CLOCK: No block to evict");
+}
+
+/* ---------------- 2Q ---------------- */
+
+TwoQueuePolicy::TwoQueuePolicy(size_t capacity)
+    : EvictionPolicy(capacity), m_lists(capacity, 2), m_a1out(std::max<size_t>(1, capacity / 2)), m_keys(capacity, 0),
+      m_kin(std::max<size_t>(1, capacity / 4)), m_kout(std::max<size_t>(1, capacity / 2)) {
+}
+
+void TwoQueuePolicy::onInsert(size_t slot, size_t key) {
+    m_keys[slot] = key;
+    bool hot = m_a1out.erase(key); // 最近从A1in淘汰过，说明不是一次性访问
+    m_lists.pushFront(hot ? AM : A1IN, slot);
+}
+
+void TwoQueuePolicy::onAccess(size_t slot) {
+    if (m_lists.listOf(slot) == AM) { // A1in中的块命中时不调整，保持FIFO顺序
+        m_lists.remove(slot);
+        m_lists.pushFront(AM, slot);
+    }
+}
+
+void TwoQueuePolicy::onRemove(size_t slot) {
+    m_lists.remove(slot);
+}
+
+size_t TwoQueuePolicy::selectVictim() {
+    int list = m_lists.size(A1IN) > m_kin || m_lists.size(AM) == 0 ? A1IN : AM;
+    size_t victim = lastUnpinned(m_lists, list);
+    if (victim == SlotLists::NONE) { // 该队列中的块都被保护，改从另一个队列淘汰
+        list = list == A1IN ? AM : A1IN;
+        victim = lastUnpinned(m_lists, list);
+    }
+    if (victim == SlotLists::NONE) {
+        throw std::runtime_error("2Q: No block to evict");
+    }
+    if (list == A1IN) {
+        m_a1out.pushFront(m_keys[victim]); // 记住被淘汰的首次访问块，A1out按m_kout创建，满时挤掉最早的记录
+    }
+    m_lists.remove(victim);
+    return victim;
+}
+
+/* ---------------- ARC ---------------- */
+
+ArcPolicy::ArcPolicy(size_t capacity)
+    : EvictionPolicy(capacity), m_lists(capacity, 2), m_b1(capacity), m_b2(2 * capacity), // |T1| + |B1| <= c，四个队列合计 <= 2c
+      m_keys(capacity, 0), m_capacity(capacity), m_target(0), m_ghostHitB2(false) {
+}
+
+void ArcPolicy::onMiss(size_t key) {
+    // 只调整目标，幽灵记录留到onInsert时再移除
+    m_ghostHitB2 = false;
+    if (m_b1.contains(key)) { // B1命中：T1太小，增大目标
+        size_t delta = std::max<size_t>(1, m_b2.size() / m_b1.size());
+        m_target = std::min(m_target + delta, m_capacity);
+    } else if (m_b2.contains(key)) { // B2命中：T2太小，减小目标
+        size_t delta = std::max<size_t>(1, m_b1.size() / m_b2.size());
+        m_target = m_target > delta ? m_target - delta : 0;
+        m_ghostHitB2 = true;
+    } else { // 全新的块：限制幽灵队列的长度
+        size_t t1 = m_lists.size(T1);
+        if (t1 + m_b1.size() >= m_capacity && m_b1.size() > 0) {
+            m_b1.popBack();
+        } else if (t1 + m_lists.size(T2) + m_b1.size() + m_b2.size() >= 2 * m_capacity && m_b2.size() > 0) {
+            m_b2.popBack();
+        }
+    }
+}
+
+void ArcPolicy::onInsert(size_t slot, size_t key) {
+    m_keys[slot] = key;
+    bool ghostHit = m_b1.erase(key) | m_b2.erase(key); // 曾被淘汰过的块直接进入T2
+    m_lists.pushFront(ghostHit ? T2 : T1, slot);
+}
+
+void ArcPolicy::onAccess(size_t slot) {
+    m_lists.remove(slot); // 再次访问的块进入T2
+    m_lists.pushFront(T2, slot);
+}
+
+void ArcPolicy::onRemove(size_t slot) {
+    m_lists.remove(slot);
+}
+
+size_t ArcPolicy::selectVictim() {
+    size_t t1 = m_lists.size(T1);
+    bool fromT1 = t1 > 0 && (t1 > m_target || (m_ghostHitB2 && t1 == m_target) || m_lists.size(T2) == 0);
+    size_t victim = lastUnpinned(m_lists, fromT1 ? T1 : T2);
+    if (victim == SlotLists::NONE) { // 该队列中的块都被保护，改从另一个队列淘汰
+        fromT1 = !fromT1;
+        victim = lastUnpinned(m_lists, fromT1 ? T1 : T2);
+    }
+    if (victim == SlotLists::NONE) {
+        throw std::runtime_error("ARC: No block to evict");
+    }
+    m_lists.remove(victim);
+    (fromT1 ? m_b1 : m_b2).pushFront(m_keys[victim]);
+    return victim;
+}
@@ -0,0 +1,146 @@
+#ifndef EvictionPolicy_H
+#define EvictionPolicy_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "BlockTable.h"
+
+/*
+缓存淘汰策略。策略只管理缓存槽（分片内的槽号0 ~ capacity-1）的淘汰顺序，
+缓存本身负责槽的分配、数据读写与写回。调用顺序：
+    命中：onAccess(slot)
+    未命中：onMiss(key) -> [缓存已满时 selectVictim()] -> onInsert(slot, key)
+    主动移除（关闭文件等）：onRemove(slot)
+批量读入时多个块先依次onMiss、分配槽，读完后再依次onInsert，所以onInsert不能依赖上一次onMiss留下的状态。
+setPinned(slot, true)暂时保护一个槽：它留在原来的位置，访问记录照常更新，只是selectVictim()跳过它。
+*/
+class SlotLists;
+
+class EvictionPolicy {
+public:
+    explicit EvictionPolicy(size_t capacity) : m_pinned(capacity, 0) {}
+    virtual ~EvictionPolicy() = default;
+    virtual const char* name() const = 0; // 策略名
+    virtual void onMiss(size_t key) { (void)key; } // 块未命中、即将分配槽时调用，带历史记录的策略据此调整
+    virtual void onInsert(size_t slot, size_t key) = 0; // 块装入slot后调用
+    virtual void onAccess(size_t slot) = 0; // 命中slot时调用
+    virtual void onRemove(size_t slot) = 0; // slot中的块被主动移除时调用
+    virtual size_t selectVictim() = 0; // 选出一个待淘汰、未被setPinned()保护的slot，并将其移出策略管理
+    void setPinned(size_t slot, bool pinned) { m_pinned[slot] = pinned; } // 保护或解除保护，不改变slot的位置与访问记录
+
+protected:
+    bool isPinned(size_t slot) const { return m_pinned[slot] != 0; }
+    size_t lastUnpinned(const SlotLists& lists, size_t list) const; // 链表中最靠近尾部、未被保护的槽，没有时为SlotLists::NONE
+
+private:
+    std::vector<uint8_t> m_pinned; // 被setPinned()保护的槽
+};
+
+enum class EvictionPolicyType {
+    LRU, // 最近最少使用
+    CLOCK, // 时钟算法，每个槽一个访问位
+    TWO_Q, // 2Q：新块先进入FIFO队列，再次访问才进入LRU队列
+    ARC // 自适应替换缓存
+};
+
+std::unique_ptr<EvictionPolicy> createEvictionPolicy(EvictionPolicyType type, size_t capacity); // 创建淘汰策略
+const char* evictionPolicyName(EvictionPolicyType type); // 策略名
+
+// 侵入式双向链表：链表节点就是槽号，前驱后继存放在预先分配的数组中，调整顺序时不分配内存
+class SlotLists {
+public:
+    SlotLists(size_t capacity, size_t numLists);
+    void pushFront(size_t list, size_t slot); // 插入到链表头部（最近使用端）
+    void remove(size_t slot); // 从所在链表中移除
+    size_t back(size_t list) const; // 链表尾部（最久未使用端）的槽号
+    size_t previous(size_t slot) const; // 同一链表中更靠近头部的槽号，slot是头部时为NONE
+    size_t size(size_t list) const { return m_sizes[list]; }
+    size_t listOf(size_t slot) const { return m_listOf[slot]; } // 槽所在的链表，不在任何链表中时为NONE
+    static const size_t NONE = SIZE_MAX;
+private:
+    size_t m_capacity;
+    std::vector<size_t> m_prev, m_next; // 下标capacity + i为第i个链表的哨兵节点
+    std::vector<size_t> m_listOf;
+    std::vector<size_t> m_sizes;
+};
+
+// 幽灵队列：只记录最近被淘汰块的键，用于2Q和ARC判断块是否“曾经被访问过”。
+// 节点和键索引都按容量预先分配，已满时挤掉最早的记录，记录与移除都不分配内存
+class GhostList {
+public:
+    explicit GhostList(size_t capacity);
+    void pushFront(size_t key);
+    bool erase(size_t key); // 若存在则移除并返回true
+    bool contains(size_t key) const { return m_index.contains(key); }
+    void popBack();
+    size_t size() const { return m_index.size(); }
+private:
+    SlotLists m_order; // 节点按记录的先后排列，节点号即m_keys的下标
+    std::vector<size_t> m_keys; // 节点中的键
+    std::vector<size_t> m_freeNodes; // 空闲节点号
+    BlockTable m_index; // 键 -> 节点号
+};
+
+class LruPolicy : public EvictionPolicy {
+public:
+    explicit LruPolicy(size_t capacity);
+    const char* name() const override { return "LRU"; }
+    void onInsert(size_t slot, size_t key) override;
+    void onAccess(size_t slot) override;
+    void onRemove(size_t slot) override;
+    size_t selectVictim() override;
+private:
+    SlotLists m_lists;
+};
+
+class ClockPolicy : public EvictionPolicy {
+public:
+    explicit ClockPolicy(size_t capacity);
+    const char* name() const override { return "CLOCK"; }
+    void onInsert(size_t slot, size_t key) override;
+    void onAccess(size_t slot) override;
+    void onRemove(size_t slot) override;
+    size_t selectVictim() override;
+private:
+    std::vector<uint8_t> m_referenced; // 访问位
+    std::vector<uint8_t> m_used; // 槽中是否有块
+    size_t m_hand; // 时钟指针
+};
+
+class TwoQueuePolicy : public EvictionPolicy {
+public:
+    explicit TwoQueuePolicy(size_t capacity);
+    const char* name() const override { return "2Q"; }
+    void onInsert(size_t slot, size_t key) override;
+    void onAccess(size_t slot) override;
+    void onRemove(size_t slot) override;
+    size_t selectVictim() override;
+private:
+    enum { A1IN = 0, AM = 1 }; // A1in：首次访问的FIFO队列；Am：多次访问的LRU队列
+    SlotLists m_lists;
+    GhostList m_a1out; // 从A1in淘汰的块
+    std::vector<size_t> m_keys; // 槽中块的键
+    size_t m_kin, m_kout; // A1in与A1out的容量
+};
+
+class ArcPolicy : public EvictionPolicy {
+public:
+    explicit ArcPolicy(size_t capacity);
+    const char* name() const override { return "ARC"; }
+    void onMiss(size_t key) override;
+    void onInsert(size_t slot, size_t key) override;
+    void onAccess(size_t slot) override;
+    void onRemove(size_t slot) override;
+    size_t selectVictim() override;
+private:
+    enum { T1 = 0, T2 = 1 }; // T1：只访问过一次；T2：访问过多次
+    SlotLists m_lists;
+    GhostList m_b1, m_b2; // 分别从T1、T2淘汰的块
+    std::vector<size_t> m_keys; // 槽中块的键
+    size_t m_capacity;
+    size_t m_target; // T1的目标大小p，随幽灵队列命中自适应调整
+    bool m_ghostHitB2; // 最近一次未命中的块是否在B2中，选择淘汰T1还是T2时参考
+};
+
+#endif // EvictionPolicy_H
@@ -0,0 +1,219 @@
+#include "IoEngine.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::unique_ptr<IoEngine> createIoEngine(IoEngineType type) {
+    if (type == IoEngineType::URING) {
+        try {
+            return std::unique_ptr<IoEngine>(new UringIoEngine());
+        }
+        catch (const std::runtime_error&) { // 内核不支持或被禁止（如容器的seccomp），退回同步读写
+        }
+    }
+    return std::unique_ptr<IoEngine>(new SyncIoEngine());
+}
+
+const char* ioEngineName(IoEngineType type) {
+    switch (type) {
+    case IoEngineType::SYNC: return "sync";
+    case IoEngineType::URING: return "io_uring";
+    }
+    return "UNKNOWN";
+}
+
+ssize_t IoEngine::readAt(int fd, char* buffer, size_t size, off_t offset, size_t* syscalls) {
+    struct iovec iov = {buffer, size};
+    IoRequest request = {fd, false, &iov, 1, offset, 0, 0};
+    size_t calls = submit(&request, 1);
+    if (syscalls) *syscalls += calls;
+    errno = request.error;
+    return request.result;
+}
+
+ssize_t IoEngine::writeAt(int fd, const char* data, size_t size, off_t offset, size_t* syscalls) {
+    struct iovec iov = {const_cast<char*>(data), size};
+    IoRequest request = {fd, true, &iov, 1, offset, 0, 0};
+    size_t calls = submit(&request, 1);
+    if (syscalls) *syscalls += calls;
+    errno = request.error;
+    return request.result;
+}
+
+/* ---------------- 同步引擎 ---------------- */
+
+size_t SyncIoEngine::submit(IoRequest* requests, size_t count) {
+    size_t syscalls = 0;
+    for (size_t i = 0; i < count; i++) {
+        IoRequest& request = requests[i];
+        do {
+            request.result = request.write ? ::pwritev(request.fd, request.iov, request.iovcnt, request.offset)
+                                           : ::preadv(request.fd, request.iov, request.iovcnt, request.offset);
+            syscalls++;
+        } while (request.result == -1 && errno == EINTR);
+        request.error = request.result == -1 ? errno : 0;
+    }
+    return syscalls;
+}
+
+/* ---------------- io_uring引擎 ---------------- */
+
+// 直接使用系统调用，不依赖liburing
+static int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+struct UringRing {
+    int fd = -1;
+    void* sqRing = MAP_FAILED; size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED; size_t cqRingSize = 0;
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED); size_t sqesSize = 0;
+    unsigned *sqTail, *sqMask, *sqArray; // 提交队列：用户态只推进tail，内核推进head
+    unsigned *cqHead, *cqTail, *cqMask; // 完成队列：内核推进tail，用户态推进head
+    struct io_uring_cqe* cqes;
+    unsigned entries;
+
+    explicit UringRing(unsigned depth) {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = ioUringSetup(depth, &params);
+        if (fd == -1) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + strerror(errno));
+        }
+        entries = params.sq_entries;
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP; // 提交与完成队列共用一次映射
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqRing = singleMmap ? sqRing
+                            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+            unmap();
+            throw std::runtime_error("Failed to map io_uring queues");
+        }
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~UringRing() {
+        unmap();
+    }
+
+    void unmap() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+        sqRing = cqRing = MAP_FAILED;
+        if (fd != -1) ::close(fd);
+        fd = -1;
+    }
+
+    // 提交count（不超过entries）个请求并等待全部完成，返回系统调用次数
+    size_t run(IoRequest* requests, unsigned count) {
+        unsigned tail = *sqTail;
+        for (unsigned i = 0; i < count; i++) {
+            unsigned index = (tail + i) & *sqMask;
+            struct io_uring_sqe* sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = requests[i].write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = requests[i].fd;
+            sqe->addr = reinterpret_cast<unsigned long>(requests[i].iov);
+            sqe->len = requests[i].iovcnt;
+            sqe->off = requests[i].offset;
+            sqe->user_data = i;
+            sqArray[index] = index;
+        }
+        __atomic_store_n(sqTail, tail + count, __ATOMIC_RELEASE); // 内核看到新的tail前，提交项必须已写好
+
+        size_t syscalls = 0;
+        unsigned submitted = 0, completed = 0;
+        while (completed < count) {
+            unsigned head = *cqHead;
+            unsigned ready = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != ready; head++) {
+                struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+                IoRequest& request = requests[cqe->user_data];
+                request.result = cqe->res < 0 ? -1 : cqe->res;
+                request.error = cqe->res < 0 ? -cqe->res : 0;
+                completed++;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            if (completed == count) break;
+
+            // 第一次进入内核时提交全部请求，之后只等待剩余的完成
+            int ret = ioUringEnter(fd, count - submitted, count - completed, IORING_ENTER_GETEVENTS);
+            syscalls++;
+            if (ret == -1) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + strerror(errno));
+            }
+            submitted += ret;
+        }
+        return syscalls;
+    }
+};
+
+UringIoEngine::UringIoEngine() {
+    m_idleRings.push_back(std::unique_ptr<UringRing>(new UringRing(RING_ENTRIES))); // 先建一个ring，确认内核支持
+}
+
+UringIoEngine::~UringIoEngine() {
+}
+
+std::unique_ptr<UringRing> UringIoEngine::acquireRing() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_idleRings.empty()) {
+            std::unique_ptr<UringRing> ring = std::move(m_idleRings.back());
+            m_idleRings.pop_back();
+            return ring;
+        }
+    }
+    return std::unique_ptr<UringRing>(new UringRing(RING_ENTRIES));
+}
+
+void UringIoEngine::releaseRing(std::unique_ptr<UringRing> ring) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_idleRings.push_back(std::move(ring));
+}
+
+size_t UringIoEngine::submit(IoRequest* requests, size_t count) {
+    std::unique_ptr<UringRing> ring;
+    try {
+        ring = acquireRing();
+    }
+    catch (const std::runtime_error&) { // 无法再创建ring（如达到内存锁定上限），本批改为同步读写
+        SyncIoEngine fallback;
+        return fallback.submit(requests, count);
+    }
+    size_t syscalls = 0;
+    for (size_t done = 0; done < count; done += ring->entries) { // 出错时ring状态未知，随异常一起丢弃
+        unsigned batch = static_cast<unsigned>(std::min<size_t>(count - done, ring->entries));
+        syscalls += ring->run(requests + done, batch);
+    }
+    releaseRing(std::move(ring));
+    return syscalls;
+}
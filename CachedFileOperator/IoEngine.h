@@ -0,0 +1,70 @@
+#ifndef IoEngine_H
+#define IoEngine_H
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+缓存的I/O引擎。缓存把一批互不依赖的读写请求交给引擎，引擎全部完成后返回：
+    同步引擎逐个调用preadv/pwritev，每个请求一次系统调用；
+    io_uring引擎把整批请求放入提交队列，用一次io_uring_enter提交并等待全部完成。
+*/
+typedef struct IoRequest{
+    int fd; //文件描述符
+    bool write; //true为写，false为读
+    const struct iovec* iov; //数据缓冲区
+    int iovcnt; //缓冲区个数，不超过IOV_MAX
+    off_t offset; //文件偏移量
+    ssize_t result; //完成后的读写字节数，失败时为-1
+    int error; //失败时的errno
+}IoRequest;
+
+enum class IoEngineType {
+    SYNC, // 同步preadv/pwritev
+    URING // io_uring批量提交，内核不支持时退回SYNC
+};
+
+class IoEngine {
+public:
+    virtual ~IoEngine() = default;
+    virtual const char* name() const = 0; // 引擎名
+    // 执行一批请求，全部完成后返回，结果写入每个请求的result/error。可被多个线程并发调用，返回发出的系统调用次数
+    virtual size_t submit(IoRequest* requests, size_t count) = 0;
+    // 单个请求的便捷接口，语义同::pread/::pwrite：失败返回-1并设置errno
+    ssize_t readAt(int fd, char* buffer, size_t size, off_t offset, size_t* syscalls = nullptr);
+    ssize_t writeAt(int fd, const char* data, size_t size, off_t offset, size_t* syscalls = nullptr);
+};
+
+std::unique_ptr<IoEngine> createIoEngine(IoEngineType type); // 创建I/O引擎
+const char* ioEngineName(IoEngineType type); // 引擎名
+
+class SyncIoEngine : public IoEngine {
+public:
+    const char* name() const override { return "sync"; }
+    size_t submit(IoRequest* requests, size_t count) override;
+};
+
+struct UringRing; // 一个io_uring实例及其映射的提交、完成队列
+
+class UringIoEngine : public IoEngine {
+public:
+    static const unsigned RING_ENTRIES = 64; // 每个ring的队列深度，更大的批次分多轮提交
+
+    UringIoEngine(); // 内核不支持io_uring时抛出异常
+    ~UringIoEngine() override;
+    const char* name() const override { return "io_uring"; }
+    size_t submit(IoRequest* requests, size_t count) override;
+private:
+    std::unique_ptr<UringRing> acquireRing(); // 取出一个空闲的ring，没有时新建
+    void releaseRing(std::unique_ptr<UringRing> ring);
+
+    // 一个ring同一时刻只能被一个线程使用，多个线程并发提交时各用各的ring，互不等待
+    std::mutex m_mutex; // 保护m_idleRings
+    std::vector<std::unique_ptr<UringRing>> m_idleRings;
+};
+
+#endif // IoEngine_H
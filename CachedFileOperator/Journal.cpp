@@ -0,0 +1,182 @@
+#include "Journal.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <unistd.h>
+
+const uint32_t Journal::RECORD_MAGIC;
+const size_t Journal::PREALLOCATE_SIZE;
+
+static const uint32_t* crcTable() {
+    static uint32_t table[256];
+    static bool initialized = [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0);
+            }
+            table[i] = crc;
+        }
+        return true;
+    }();
+    (void)initialized;
+    return table;
+}
+
+static uint32_t crc32(uint32_t crc, const void* data, size_t size) {
+    const uint32_t* table = crcTable();
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+uint32_t Journal::checksum(const RecordHeader& header, const char* data) {
+    uint32_t crc = 0xFFFFFFFFu;
+    crc = crc32(crc, &header.lsn, sizeof(header.lsn));
+    crc = crc32(crc, &header.offset, sizeof(header.offset));
+    crc = crc32(crc, &header.length, sizeof(header.length));
+    crc = crc32(crc, data, header.length);
+    return ~crc;
+}
+
+// 写完size字节，处理部分写入
+static bool writeFully(int fd, const char* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t written = ::pwrite(fd, data, size, offset);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+Journal::Journal(const std::string& path) {
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (m_fd == -1) {
+        throw std::runtime_error("Failed to open journal: " + path);
+    }
+}
+
+Journal::~Journal() {
+    ::close(m_fd);
+}
+
+uint64_t Journal::append(off_t offset, const char* data, size_t size) {
+    RecordHeader header;
+    header.magic = RECORD_MAGIC;
+    header.offset = offset;
+    header.length = size;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    header.lsn = m_appendedLsn;
+    header.checksum = checksum(header, data);
+    const char* bytes = reinterpret_cast<const char*>(&header);
+    m_pending.insert(m_pending.end(), bytes, bytes + sizeof(header));
+    m_pending.insert(m_pending.end(), data, data + size);
+    m_appendedLsn += sizeof(header) + size;
+    return m_appendedLsn;
+}
+
+size_t Journal::commit(uint64_t lsn) {
+    size_t syncs = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_durableLsn < lsn) {
+        if (m_failed) {
+            throw std::runtime_error("Journal write failed");
+        }
+        if (m_syncing) { // 其他线程正在提交，等它完成后再看自己的记录是否已包含在内
+            m_committed.wait(lock);
+            continue;
+        }
+        // 成为本轮提交者，把缓冲中所有线程的记录一起写入
+        m_syncing = true;
+        std::vector<char> batch;
+        batch.swap(m_pending);
+        uint64_t batchLsn = m_appendedLsn;
+        off_t fileOffset = batchLsn - batch.size() - m_fileLsn;
+        lock.unlock();
+        bool ok = preallocate(fileOffset + batch.size()) && writeFully(m_fd, batch.data(), batch.size(), fileOffset) && fdatasync(m_fd) == 0;
+        syncs++;
+        lock.lock();
+        m_syncing = false;
+        if (ok) {
+            m_durableLsn = batchLsn;
+        } else {
+            m_failed = true;
+        }
+        m_committed.notify_all();
+    }
+    return syncs;
+}
+
+bool Journal::preallocate(size_t end) {
+    if (end <= m_allocated) return true;
+    size_t newSize = (end + PREALLOCATE_SIZE - 1) / PREALLOCATE_SIZE * PREALLOCATE_SIZE;
+    std::vector<char> zeros(newSize - m_allocated, 0); // 真正写入0，之后覆盖写不再需要分配块、修改元数据
+    if (!writeFully(m_fd, zeros.data(), zeros.size(), m_allocated)) return false;
+    m_allocated = newSize;
+    return true;
+}
+
+void Journal::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_appendedLsn == m_fileLsn) return; // 日志已为空，第一条记录头已清零
+    // 旧记录此后可能不再包含在数据文件中（例如检查点后打洞），先把第一条记录头清零并落盘，崩溃后不会重放任何旧记录。
+    // 之后的记录从文件开头覆盖旧记录。lsn继续增长，残留的旧记录与新记录的lsn不连续，不会被重放
+    RecordHeader empty;
+    memset(&empty, 0, sizeof(empty));
+    if (!writeFully(m_fd, reinterpret_cast<const char*>(&empty), sizeof(empty), 0) || fdatasync(m_fd) == -1) {
+        throw std::runtime_error("Failed to reset journal");
+    }
+    m_fileLsn = m_appendedLsn;
+}
+
+size_t Journal::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_appendedLsn - m_fileLsn;
+}
+
+size_t Journal::replay(const std::string& path, int dataFd) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) return 0;
+        throw std::runtime_error("Failed to open journal: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat journal: " + path);
+    }
+    size_t records = 0;
+    off_t position = 0;
+    uint64_t expectedLsn = 0;
+    std::vector<char> data;
+    while (true) {
+        RecordHeader header;
+        if (::pread(fd, &header, sizeof(header), position) != static_cast<ssize_t>(sizeof(header))) break; // 日志结束或记录不完整
+        if (header.magic != RECORD_MAGIC || (records > 0 && header.lsn != expectedLsn)) break;
+        if (header.length > static_cast<uint64_t>(st.st_size - position - sizeof(header))) break; // 长度损坏或数据不完整
+        data.resize(header.length);
+        if (::pread(fd, data.data(), header.length, position + sizeof(header)) != static_cast<ssize_t>(header.length)) break;
+        if (checksum(header, data.data()) != header.checksum) break; // 崩溃时未写完的记录
+        if (!writeFully(dataFd, data.data(), header.length, header.offset)) {
+            ::close(fd);
+            throw std::runtime_error("Failed to replay journal: " + path);
+        }
+        records++;
+        position += sizeof(header) + header.length;
+        expectedLsn = header.lsn + sizeof(header) + header.length;
+    }
+    ::close(fd);
+    if (records > 0 && fdatasync(dataFd) == -1) {
+        throw std::runtime_error("Failed to sync replayed file: " + path);
+    }
+    return records;
+}
@@ -0,0 +1,60 @@
+#ifndef Journal_H
+#define Journal_H
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/*
+预写日志：写入先按顺序追加到日志文件并fdatasync，再写入缓存，脏块照常延迟写回数据文件。
+日志记录格式：RecordHeader + 数据。lsn是记录在日志中的逻辑位置（只增不减，截断日志后也继续增长），
+重放时要求每条记录的lsn紧接上一条，遇到校验失败、不连续或不完整的记录即停止，这样检查点之前残留的旧记录不会被重放。
+日志文件按PREALLOCATE_SIZE预先写0扩展，检查点时把第一条记录头清零并落盘，之后从头覆盖而不截断，追加记录不改变文件大小，fdatasync只需写数据。
+
+成组提交：append()只把记录放入内存缓冲，commit()时由一个线程把缓冲中所有线程的记录一次写入并fdatasync，
+其余线程等待它完成，所以并发写入时多个写入共用一次fdatasync。
+*/
+class Journal {
+public:
+    typedef struct RecordHeader{
+        uint32_t magic; //RECORD_MAGIC
+        uint32_t checksum; //lsn、offset、length与数据的CRC32
+        uint64_t lsn; //记录在日志中的逻辑位置
+        uint64_t offset; //数据在数据文件中的偏移量
+        uint64_t length; //数据长度
+    }RecordHeader;
+    static const uint32_t RECORD_MAGIC = 0x4A524E4C; // "JRNL"
+    static const size_t PREALLOCATE_SIZE = 4 * 1024 * 1024; // 日志文件每次扩展的大小
+
+    explicit Journal(const std::string& path); // 创建（或清空）日志文件，失败时抛出异常
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    uint64_t append(off_t offset, const char* data, size_t size); // 把一次写入加入待写缓冲，返回其结束lsn
+    size_t commit(uint64_t lsn); // 等待lsn之前的记录都已落盘，返回本线程执行的fdatasync次数；写日志失败时抛出异常
+    void reset(); // 清空日志（数据已全部写回并同步到数据文件后调用），调用者需保证没有未提交的记录；清空失败时抛出异常
+    size_t size(); // 日志中记录的总大小（含未提交的记录）
+
+    // 把日志中的有效记录按顺序写入数据文件并fdatasync，返回重放的记录数；日志不存在时返回0
+    static size_t replay(const std::string& path, int dataFd);
+private:
+    static uint32_t checksum(const RecordHeader& header, const char* data);
+    bool preallocate(size_t end); // 确保日志文件不小于end，不足时写0扩展；只由提交者调用
+
+    int m_fd;
+    std::mutex m_mutex; // 保护以下成员
+    std::condition_variable m_committed; // 一次成组提交完成时通知
+    std::vector<char> m_pending; // 尚未写入日志文件的记录
+    uint64_t m_appendedLsn = 0; // 已加入缓冲的记录结束lsn
+    uint64_t m_durableLsn = 0; // 已落盘的记录结束lsn
+    uint64_t m_fileLsn = 0; // 日志文件开头对应的lsn，检查点时推进
+    size_t m_allocated = 0; // 日志文件已扩展到的大小，由提交者访问
+    bool m_syncing = false; // 是否有线程正在写日志
+    bool m_failed = false; // 写日志失败后不再接受提交
+};
+
+#endif // Journal_H
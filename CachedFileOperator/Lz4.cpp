@@ -0,0 +1,156 @@
+#include "Lz4.h"
+#include <cstdint>
+#include <cstring>
+
+static const size_t MIN_MATCH = 4; // 最短匹配
+static const size_t LAST_LITERALS = 5; // 最后5个字节必须是字面量
+static const size_t MF_LIMIT = 12; // 最后一个匹配必须在距末尾12字节之前开始
+static const size_t MAX_OFFSET = 65535; // 偏移量用2字节表示
+static const unsigned HASH_BITS = 12; // 哈希表4096项
+static const unsigned SKIP_TRIGGER = 6; // 每连续2^6次找不到匹配，步长加1
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hashOf(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - HASH_BITS);
+}
+
+// 写入长度的扩展字节：每个255表示还有后续字节，最后一个小于255
+static uint8_t* writeLength(uint8_t* op, size_t length) {
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+// 输出一个序列，空间不足时返回nullptr。matchLength为0表示最后一个只有字面量的序列
+static uint8_t* writeSequence(uint8_t* op, uint8_t* oend, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t needed = 1 + literalLength / 255 + 1 + literalLength + (matchLength ? 2 + (matchLength - MIN_MATCH) / 255 + 1 : 0);
+    if (needed > static_cast<size_t>(oend - op)) return nullptr;
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) op = writeLength(op, literalLength - 15);
+    memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength == 0) return op;
+
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    size_t length = matchLength - MIN_MATCH;
+    *token |= static_cast<uint8_t>(length >= 15 ? 15 : length);
+    if (length >= 15) op = writeLength(op, length - 15);
+    return op;
+}
+
+size_t lz4Compress(const char* src, size_t srcSize, char* dst, size_t dstCapacity) {
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = base + srcSize;
+    const uint8_t* anchor = base; // 尚未输出的字面量的起点
+    uint8_t* op = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* oend = op + dstCapacity;
+
+    if (srcSize > MF_LIMIT) {
+        const uint8_t* mfLimit = end - MF_LIMIT; // 匹配起点的上界
+        const uint8_t* matchLimit = end - LAST_LITERALS; // 匹配终点的上界
+        uint32_t table[1 << HASH_BITS]; // 哈希 -> 最近一次出现的位置（相对base）
+        memset(table, 0, sizeof(table));
+        const uint8_t* ip = base + 1;
+        size_t misses = 0;
+        while (ip < mfLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t& entry = table[hashOf(sequence)];
+            const uint8_t* ref = base + entry;
+            entry = static_cast<uint32_t>(ip - base);
+            if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+                ip += 1 + (misses++ >> SKIP_TRIGGER);
+                continue;
+            }
+            misses = 0;
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) { // 向前扩展匹配
+                ip--;
+                ref--;
+            }
+            size_t length = MIN_MATCH;
+            while (ip + length + 8 <= matchLimit) { // 每次比较8字节，第一个不同的字节由异或结果的低位0的个数得出（小端）
+                uint64_t diff = read64(ip + length) ^ read64(ref + length);
+                if (diff) {
+                    length += __builtin_ctzll(diff) >> 3;
+                    break;
+                }
+                length += 8;
+            }
+            if (ip + length + 8 > matchLimit) {
+                while (ip + length < matchLimit && ip[length] == ref[length]) length++;
+            }
+
+            op = writeSequence(op, oend, anchor, ip - anchor, ip - ref, length);
+            if (!op) return 0;
+            ip += length;
+            anchor = ip;
+            if (ip < mfLimit) table[hashOf(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+        }
+    }
+    op = writeSequence(op, oend, anchor, end - anchor, 0, 0);
+    if (!op) return 0;
+    return op - reinterpret_cast<uint8_t*>(dst);
+}
+
+bool lz4Decompress(const char* src, size_t srcSize, char* dst, size_t dstSize) {
+    const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* iend = ip + srcSize;
+    uint8_t* base = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op = base;
+    uint8_t* oend = base + dstSize;
+
+    // 读取扩展长度字节
+    auto readLength = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= iend) return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) return false;
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op)) return false;
+        if (literalLength <= 16 && iend - ip >= 16 && oend - op >= 16) { // 短字面量固定复制16字节，多写的部分随后被覆盖
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, literalLength);
+        }
+        ip += literalLength;
+        op += literalLength;
+        if (ip == iend) break; // 最后一个序列
+
+        if (iend - ip < 2) return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - base)) return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(oend - op)) return false;
+        const uint8_t* ref = op - offset;
+        if (offset >= 8 && static_cast<size_t>(oend - op) >= matchLength + 8) { // 每次复制8字节，最多多写7字节
+            for (size_t i = 0; i < matchLength; i += 8) memcpy(op + i, ref + i, 8);
+        } else { // 与输出重叠（重复模式）或接近末尾，逐字节复制
+            for (size_t i = 0; i < matchLength; i++) op[i] = ref[i];
+        }
+        op += matchLength;
+    }
+    return op == oend;
+}
@@ -0,0 +1,16 @@
+#ifndef Lz4_H
+#define Lz4_H
+#include <cstddef>
+
+/*
+LZ4块格式的压缩与解压（不含帧格式），供压缩二级缓存使用。
+每个序列为：token（高4位字面量长度，低4位匹配长度-4，15表示后面还有长度字节）、字面量、2字节小端偏移量、匹配长度字节；
+最后一个序列只有字面量。压缩用单个哈希表贪心匹配，连续找不到匹配时加大步长，不可压缩的数据很快放弃。
+*/
+
+// 压缩src到dst，返回压缩后的大小；结果超过dstCapacity时返回0（调用者据此判断压缩效果不足）
+size_t lz4Compress(const char* src, size_t srcSize, char* dst, size_t dstCapacity);
+// 解压到dst，解压结果必须恰好为dstSize字节；数据损坏时返回false，不会越界读写
+bool lz4Decompress(const char* src, size_t srcSize, char* dst, size_t dstSize);
+
+#endif // Lz4_H
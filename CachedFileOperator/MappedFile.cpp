@@ -0,0 +1,98 @@
+#include "MappedFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t pageAlign(size_t size) { // 向上对齐到页，至少一页（mmap不接受长度0）
+    size_t page = sysconf(_SC_PAGESIZE);
+    return std::max((size + page - 1) / page * page, page);
+}
+
+MappedFile::MappedFile(int fd, AccessHint hint) : m_fd(fd), m_hint(hint) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        throw std::runtime_error(std::string("Failed to stat mapped file: ") + strerror(errno));
+    }
+    m_size = st.st_size;
+    m_capacity = pageAlign(m_size);
+    // 超出文件大小的页访问会产生SIGBUS，读写前都先检查或扩展文件大小
+    void* data = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error(std::string("Failed to map file: ") + strerror(errno));
+    }
+    m_data = static_cast<char*>(data);
+    advise();
+}
+
+MappedFile::~MappedFile() {
+    munmap(m_data, m_capacity);
+}
+
+void MappedFile::advise() {
+    int advice = m_hint == AccessHint::SEQUENTIAL ? MADV_SEQUENTIAL
+               : m_hint == AccessHint::RANDOM ? MADV_RANDOM : MADV_NORMAL;
+    madvise(m_data, m_capacity, advice); // 只是提示，失败不影响读写
+}
+
+void MappedFile::read(char* buffer, size_t size, off_t offset) {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    size_t from = std::min<size_t>(offset, m_size);
+    size_t valid = std::min(size, m_size - from);
+    memcpy(buffer, m_data + from, valid);
+    memset(buffer + valid, 0, size - valid); // 与缓存一致：文件末尾之后读到0
+}
+
+void MappedFile::write(const char* data, size_t size, off_t offset) {
+    size_t end = offset + size;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        if (end <= m_size) {
+            memcpy(m_data + offset, data, size);
+            return;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    if (end > m_size) {
+        grow(end);
+    }
+    memcpy(m_data + offset, data, size);
+}
+
+void MappedFile::grow(size_t newSize) {
+    if (ftruncate(m_fd, newSize) == -1) {
+        throw std::runtime_error(std::string("Failed to extend mapped file: ") + strerror(errno));
+    }
+    if (newSize > m_capacity) {
+        remap(newSize);
+    }
+    m_size = newSize; // 映射区足够大之后才能访问新的部分
+}
+
+void MappedFile::remap(size_t newSize) {
+    size_t capacity = std::max(pageAlign(newSize), m_capacity * 2); // 按2倍增长，连续追加时mremap次数为对数级
+    void* data = mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error(std::string("Failed to remap file: ") + strerror(errno));
+    }
+    m_data = static_cast<char*>(data);
+    m_capacity = capacity;
+    advise();
+}
+
+void MappedFile::sync() {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (m_size > 0 && msync(m_data, m_size, MS_SYNC) == -1) {
+        throw std::runtime_error(std::string("Failed to sync mapped file: ") + strerror(errno));
+    }
+}
+
+size_t MappedFile::size() {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_size;
+}
@@ -0,0 +1,43 @@
+#ifndef MappedFile_H
+#define MappedFile_H
+#include <cstddef>
+#include <shared_mutex>
+#include <sys/types.h>
+
+// 访问模式提示，映射时通过madvise告诉内核
+enum class AccessHint {
+    NORMAL, // 默认预读
+    SEQUENTIAL, // MADV_SEQUENTIAL：加大预读，读过的页可尽快回收
+    RANDOM // MADV_RANDOM：关闭预读
+};
+
+/*
+内存映射文件：把整个文件映射到内存，读写直接复制映射区，不经过块缓存。
+映射区按2倍增长预留（mremap），超出文件大小的写入先用ftruncate扩展文件，所以文件大小始终是真实大小。
+读写持有共享锁，扩展文件时持有独占锁（mremap可能移动映射区）。
+*/
+class MappedFile {
+public:
+    MappedFile(int fd, AccessHint hint); // 映射fd对应的整个文件，失败时抛出异常
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void read(char* buffer, size_t size, off_t offset); // 读取[offset, offset + size)，超出文件大小的部分填0
+    void write(const char* data, size_t size, off_t offset); // 写入，超出文件大小时扩展文件
+    void sync(); // msync(MS_SYNC)：把修改过的页写入文件并等待完成
+    size_t size(); // 文件大小
+private:
+    void grow(size_t newSize); // 把文件扩展到newSize，必要时扩大映射区；调用者需持有独占锁
+    void remap(size_t newSize); // 把映射区扩大到不小于newSize，映射区可能移动
+    void advise(); // 对整个映射区应用访问模式提示
+
+    int m_fd;
+    AccessHint m_hint;
+    char* m_data; // 映射区
+    size_t m_capacity; // 映射区大小，页对齐，不小于文件大小
+    size_t m_size; // 文件大小
+    std::shared_mutex m_mutex; // 读写为共享，扩展文件为独占
+};
+
+#endif // MappedFile_H
@@ -0,0 +1,137 @@
+#include "Trace.h"
+#include <cstring>
+#include <stdexcept>
+
+static const char TRACE_MAGIC[8] = {'C', 'F', 'O', 'T', 'R', 'A', 'C', 'E'};
+static const uint32_t TRACE_VERSION = 1;
+static const size_t TRACE_BUFFER_RECORDS = 64 * 1024 / sizeof(TraceRecord); // 缓冲64KB
+
+typedef struct TraceHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+}TraceHeader;
+
+TraceWriter::TraceWriter(const std::string& path) : m_file(fopen(path.c_str(), "wb")) {
+    if (m_file == nullptr) {
+        throw std::runtime_error("Failed to create trace file: " + path);
+    }
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        fclose(m_file);
+        throw std::runtime_error("Failed to write trace file: " + path);
+    }
+    m_buffer.reserve(TRACE_BUFFER_RECORDS);
+}
+
+TraceWriter::~TraceWriter() {
+    try {
+        close();
+    }
+    catch (const std::runtime_error&) { // 析构时只能放弃剩余记录
+    }
+}
+
+void TraceWriter::append(const TraceRecord& record) {
+    m_buffer.push_back(record);
+    if (m_buffer.size() == TRACE_BUFFER_RECORDS) drain();
+}
+
+void TraceWriter::drain() {
+    if (m_buffer.empty()) return;
+    size_t written = fwrite(m_buffer.data(), sizeof(TraceRecord), m_buffer.size(), m_file);
+    bool failed = written != m_buffer.size();
+    m_buffer.clear();
+    if (failed) {
+        throw std::runtime_error("Failed to write trace file");
+    }
+}
+
+void TraceWriter::close() {
+    if (m_file == nullptr) return;
+    bool failed = false;
+    try {
+        drain();
+    }
+    catch (const std::runtime_error&) {
+        failed = true;
+    }
+    failed |= fclose(m_file) != 0;
+    m_file = nullptr;
+    if (failed) {
+        throw std::runtime_error("Failed to close trace file");
+    }
+}
+
+std::vector<TraceRecord> readTrace(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+        fclose(file);
+        throw std::runtime_error("Invalid trace file: " + path);
+    }
+    std::vector<TraceRecord> records;
+    TraceRecord buffer[1024];
+    size_t n;
+    while ((n = fread(buffer, sizeof(TraceRecord), 1024, file)) > 0) {
+        records.insert(records.end(), buffer, buffer + n);
+    }
+    bool failed = ferror(file);
+    fclose(file);
+    if (failed) {
+        throw std::runtime_error("Failed to read trace file: " + path);
+    }
+    return records;
+}
+
+TraceRecorder::~TraceRecorder() {
+    try {
+        stop();
+    }
+    catch (const std::runtime_error&) {
+    }
+}
+
+void TraceRecorder::start(const std::string& path) {
+    std::unique_ptr<TraceWriter> writer(new TraceWriter(path));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writer = std::move(writer); // 上一个跟踪的剩余记录在析构时写出
+    m_start = std::chrono::steady_clock::now();
+    m_active = true;
+}
+
+void TraceRecorder::stop() {
+    std::unique_ptr<TraceWriter> writer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_active = false;
+        writer = std::move(m_writer);
+    }
+    if (writer) writer->close();
+}
+
+void TraceRecorder::recordLocked(TraceOp op, int fh, uint64_t offset, size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_writer == nullptr) return; // 检查m_active之后被停止
+    TraceRecord record;
+    record.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    record.offset = offset;
+    record.size = static_cast<uint32_t>(size);
+    record.fh = static_cast<uint16_t>(fh);
+    record.op = op;
+    record.reserved = 0;
+    try {
+        m_writer->append(record);
+    }
+    catch (const std::runtime_error&) { // 写跟踪失败不影响读写，停止记录
+        m_active = false;
+        m_writer.reset();
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef Trace_H
+#define Trace_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 跟踪记录的操作
+enum TraceOp : uint8_t {
+    TRACE_READ, //pread()等读取
+    TRACE_WRITE, //pwrite()等写入
+    TRACE_FLUSH //flush(fh)；fh为TRACE_ALL_FILES时为flush()
+};
+
+static const uint16_t TRACE_ALL_FILES = 0xFFFF;
+
+// 一次操作，24字节，按小端直接写入文件
+typedef struct TraceRecord{
+    uint64_t timestampNs; //相对跟踪开始的时间
+    uint64_t offset; //文件偏移量
+    uint32_t size; //大小
+    uint16_t fh; //文件句柄
+    uint8_t op; //TraceOp
+    uint8_t reserved;
+}TraceRecord;
+
+/*
+跟踪文件：16字节的文件头（魔数"CFOTRACE"、版本、记录大小）后是连续的TraceRecord。
+写入先进入内存缓冲，满64KB后一次fwrite。
+*/
+class TraceWriter {
+public:
+    explicit TraceWriter(const std::string& path); // 创建（覆盖）跟踪文件，失败时抛出异常
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void append(const TraceRecord& record);
+    void close(); // 写出缓冲并关闭，写入失败时抛出异常
+private:
+    void drain(); // 把缓冲写入文件
+    FILE* m_file;
+    std::vector<TraceRecord> m_buffer;
+};
+
+std::vector<TraceRecord> readTrace(const std::string& path); // 读取整个跟踪文件，格式不对时抛出异常
+
+/*
+运行中的缓存记录跟踪。未开始时record()只有一次原子读；记录时持有一个互斥锁，只用于诊断与生成基准测试的负载。
+*/
+class TraceRecorder {
+public:
+    TraceRecorder() = default;
+    ~TraceRecorder(); // 停止并写出剩余记录
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    void start(const std::string& path); // 开始记录到path（已在记录时先停止上一个），时间戳从此刻算起
+    void stop(); // 停止记录并关闭文件
+    void record(TraceOp op, int fh, uint64_t offset, size_t size) {
+        if (m_active.load(std::memory_order_relaxed)) recordLocked(op, fh, offset, size);
+    }
+private:
+    void recordLocked(TraceOp op, int fh, uint64_t offset, size_t size);
+    std::atomic<bool> m_active{false};
+    std::mutex m_mutex; // 保护m_writer
+    std::unique_ptr<TraceWriter> m_writer;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // Trace_H
@@ -9,6 +9,7 @@
     #define LOG(text) // 不执行任何操作
 #endif
 
+const size_t SortManager::NONE;
 
 SortManager::SortManager(const std::string& dir, size_t numThread, size_t bufferSize, size_t totalFileSize)
     :pool(numThread), numThread(numThread), bufferSize(bufferSize), totalFileSize(totalFileSize) {
@@ -31,12 +32,7 @@ SortManager::SortManager(const std::string& dir, size_t numThread, size_t buffer
     if(totalFileSize % bufferSize != 0) numIntermediate++;
     
     buffer = std::make_unique<long long[]>(bufferSize / sizeof(long long));
-    buffer2 = std::make_unique<long long[]>(bufferSize / sizeof(long long));
-    state = State::Running;
-
-    terminate.store(0);
-    readyHeapsCount.store(0);
-    runningMergeIntermediateCount.store(0);
+    mergeBuffer = std::make_unique<long long[]>(bufferSize / sizeof(long long));
 
     interDir = "./intermediate/"; // 中间文件目录
     fs::path dirPath(interDir);
@@ -58,41 +54,28 @@ SortManager::SortManager(const std::string& dir, size_t numThread, size_t buffer
 }
 
 void SortManager::Run(){
-    state = State::ReadyToReadToCache;
-    while(true){
-        std::unique_lock<std::mutex> lock(stateMutex);
-        cvTask.wait(lock, [this]() { return state != State::Running; }); // 用条件变量控制主线程
-        switch (state) {
-        case State::Running:
-            break;
-        case State::ReadyToReadToCache: // 准备读数据到缓存
-            pool.addTask([this]() { this->ReadToCache(); });
-            SetState(State::Running);
-            break;
-        case State::ReadyToReadToHeaps: // 准备将缓存的数据读到堆中
-            readyHeapsCount.store(0);
-            for(size_t i = 0; i < numThread; i++){
-                size_t threadIndex = i;
-                pool.addTask([this, threadIndex]() { this->ReadToHeap(threadIndex); });
-            }
-            SetState(State::Running);
-            break;
-        case State::ReadyToMergeHeaps: // 准备合并堆
-            pool.addTask([this]() { this->MergeHeaps(); });
-            SetState(State::Running);
-            break;
-        case State::ReadyToMergeIntermediates:{ //准备合并中间文件
-            size_t threadsToUse = std::min(numIntermediate, numThread);
-            for(size_t i = 0; i < threadsToUse; i++){
-                pool.addTask([this]() { this->MergeIntermediate(); });
-            }
-            SetState(State::Running);
-            break;
-        }
-        case State::Stop: //停止
-            return; // 退出循环
+    if (numIntermediate == 0) { // 没有输入数据：结果为空文件
+        std::ofstream(interDir + "Inter0.bin", std::ios::binary);
+        MoveResult(0);
+        return;
+    }
+    mergeTree.clear();
+    leafNodes.assign(numIntermediate, NONE);
+    BuildMergeTree(0, numIntermediate, NONE);
+    {
+        TaskGroup merges(pool); // 合并中间文件的任务；提前退出时析构函数等它们结束
+        // 每一轮：读缓存 -> 各线程建堆 -> 合并堆，生成一个中间文件。各轮共用缓存和堆，依次进行，在关键路径上，以高优先级执行。
+        // 合并中间文件使用单独的缓冲区，两个输入都生成后即以低优先级开始，与后面的轮次同时进行而不挡住它们
+        while (intermediates.size() < numIntermediate) {
+            pool.submit([this]() { this->ReadToCache(); }, TaskPriority::High)
+                .then([this]() { this->ReadToHeaps(); }, TaskPriority::High)
+                .then([this]() { this->MergeHeaps(); }, TaskPriority::High)
+                .get();
+            MergeNodeDone(merges, leafNodes[intermediates.size() - 1]);
         }
+        merges.wait();
     }
+    MoveResult(mergeTree[0].first);
 }
 
 void SortManager::ReadToCache() { // 读取数据填满整块缓存
@@ -153,9 +136,6 @@ void SortManager::ReadToCache() { // 读取数据填满整块缓存
         }
     }
     LOG("ReadToCacheFinished\n\n");
-    std::unique_lock<std::mutex> lock2(stateMutex);
-    SetState(State::ReadyToReadToHeaps);
-    cvTask.notify_one();
 }
 
 
@@ -174,16 +154,17 @@ void SortManager::ReadToHeap(size_t i) { // 将缓存数据中第i块读取到
         long long value = buffer[index];
         heap.push(value); 
     }
-    std::unique_lock<std::mutex> lock2(readyHeapsCountMutex);
-    readyHeapsCount++;
     info = info + " finished";
     LOG(info + "\n");
-    if (readyHeapsCount.load() == numThread){
-        LOG("ReadToHeap all finished\n\n");
-        std::unique_lock<std::mutex> lock3(stateMutex);
-        SetState(State::ReadyToMergeHeaps);
-        cvTask.notify_one();
+}
+
+void SortManager::ReadToHeaps() {
+    TaskGroup group(pool);
+    for (size_t i = 0; i < numThread; i++) {
+        group.run([this, i]() { this->ReadToHeap(i); }, TaskPriority::High);
     }
+    group.wait();
+    LOG("ReadToHeap all finished\n\n");
 }
 
 
@@ -193,7 +174,7 @@ void SortManager::MergeHeaps() {
 
     std::string fileName = "Inter";
     std::unique_lock<std::mutex> lock(intermediateQueueMutex);
-    size_t interNum = intermediateQueue.size();
+    size_t interNum = intermediates.size();
     lock.unlock();
     std::ofstream outFile(interDir + fileName + std::to_string(interNum) + ".bin");
     if (!outFile) {
@@ -229,61 +210,60 @@ void SortManager::MergeHeaps() {
     }
     outFile.write(reinterpret_cast<const char*>(buffer.get()), count * sizeof(long long));
     std::unique_lock<std::mutex> lock2(intermediateQueueMutex);
-    intermediateQueue.push(interNum);
+    intermediates.push_back(interNum);
     outFile.close();
     LOG("MergeHeapsFinished\n\n");
-    if(intermediateQueue.size() < numIntermediate){
-        SetState(State::ReadyToReadToCache);
-        cvTask.notify_one();
+}
+
+size_t SortManager::BuildMergeTree(size_t first, size_t count, size_t parent){ // 前一半与后一半分别合并后再合并
+    size_t node = mergeTree.size();
+    mergeTree.push_back({first, NONE, NONE, parent, 0});
+    if (count == 1) {
+        leafNodes[first] = node;
+        return node;
     }
-    else{
-        SetState(State::ReadyToMergeIntermediates);
-        cvTask.notify_one();
+    size_t half = count / 2;
+    size_t left = BuildMergeTree(first, half, node);
+    size_t right = BuildMergeTree(first + half, count - half, node);
+    mergeTree[node].left = left;
+    mergeTree[node].right = right;
+    mergeTree[node].pending = 2;
+    return node;
+}
+
+void SortManager::MergeNodeDone(TaskGroup& merges, size_t node){
+    size_t parent = mergeTree[node].parent; // 树的结构建好后不再改变，只有pending需要加锁
+    if (parent == NONE) return;
+    {
+        std::lock_guard<std::mutex> lock(intermediateQueueMutex);
+        if (--mergeTree[parent].pending > 0) return;
     }
+    size_t a = mergeTree[mergeTree[parent].left].first;
+    size_t b = mergeTree[mergeTree[parent].right].first;
+    merges.run([this, &merges, parent, a, b]() {
+        LOG("MergeIntermediate\n");
+        this->MergeTwoIntermediate(a, b);
+        this->MergeNodeDone(merges, parent);
+    }, TaskPriority::Low);
 }
 
-void SortManager::MergeIntermediate(){ // 将中间文件合并
-    std::unique_lock<std::mutex> lock(intermediateQueueMutex);
-    if(intermediateQueue.size() + runningMergeIntermediateCount.load() <= 1 && !terminate.load()) {
-        std::unique_lock<std::mutex> lock2(terminateMutex);
-        terminate.store(true);
-        lock.unlock();
-        cvTerminate.wait(lock2, [this]() { return runningMergeIntermediateCount.load() == 0; }); //等待剩下的中间文件合并任务执行完毕
-        
-        LOG("MergeIntermediateAllFinished\n\n");
-        // 将中间文件重命名
-        std::string oldName = interDir + "Inter0.bin";
-        std::string newDir = "./result/";
-        std::string newName = newDir + "sorted.bin";
-        
-        fs::path dirPath(newDir);
-        if (!fs::exists(newDir)) {
-            if (!fs::create_directory(newDir)) {
-                LOG("无法创建目录: "+ newDir + "\n");
-            }
-        }
+void SortManager::MoveResult(size_t index){ // 将最终的中间文件重命名
+    LOG("MergeIntermediateAllFinished\n\n");
+    std::string oldName = interDir + "Inter" + std::to_string(index) + ".bin";
+    std::string newDir = "./result/";
+    std::string newName = newDir + "sorted.bin";
 
-        if (rename(oldName.c_str(), newName.c_str()) != 0) {
-            LOG("重命名文件失败: \n" + oldName);
+    fs::path dirPath(newDir);
+    if (!fs::exists(newDir)) {
+        if (!fs::create_directory(newDir)) {
+            LOG("无法创建目录: "+ newDir + "\n");
         }
-        rmdir(interDir.c_str());
-
-        SetState(State::Stop);
-        cvTask.notify_one();
-        return;
     }
-    else if(intermediateQueue.size() <= 1){
-        return;
-    }
-    LOG("MergeIntermediate\n");
-    runningMergeIntermediateCount.fetch_add(1, std::memory_order_relaxed);
-    size_t a = intermediateQueue.front();
-    intermediateQueue.pop();
-    size_t b = intermediateQueue.front();
-    intermediateQueue.pop();
-    lock.unlock();
 
-    MergeTwoIntermediate(a, b);
+    if (rename(oldName.c_str(), newName.c_str()) != 0) {
+        LOG("重命名文件失败: \n" + oldName);
+    }
+    rmdir(interDir.c_str());
 }
 
 void SortManager::MergeTwoIntermediate(size_t a, size_t b){ // 将中间文件a和中间文件b合并
@@ -303,83 +283,38 @@ void SortManager::MergeTwoIntermediate(size_t a, size_t b){ // 将中间文件a
         LOG("无法打开文件。\n");
         return;
     }
-    
-    // long long num1, num2;
-    // bool hasNum1 = (inFile1.read(reinterpret_cast<char*>(&num1), sizeof(num1)), inFile1.good());
-    // bool hasNum2 = (inFile2.read(reinterpret_cast<char*>(&num2), sizeof(num2)), inFile2.good());
-
-    // while (hasNum1 && hasNum2) {
-    //     if (num1 < num2) {
-    //         outFile.write(reinterpret_cast<char*>(&num1), sizeof(num1));
-    //         hasNum1 = (inFile1.read(reinterpret_cast<char*>(&num1), sizeof(num1)), inFile1.good());
-    //     } else {
-    //         outFile.write(reinterpret_cast<char*>(&num2), sizeof(num2));
-    //         hasNum2 = (inFile2.read(reinterpret_cast<char*>(&num2), sizeof(num2)), inFile2.good());
-    //     }
-    // }
-
-    // // 处理剩余的元素
-    // while (hasNum1) {
-    //     outFile.write(reinterpret_cast<char*>(&num1), sizeof(num1));
-    //     hasNum1 = (inFile1.read(reinterpret_cast<char*>(&num1), sizeof(num1)), inFile1.good());
-    // }
-
-    // while (hasNum2) {
-    //     outFile.write(reinterpret_cast<char*>(&num2), sizeof(num2));
-    //     hasNum2 = (inFile2.read(reinterpret_cast<char*>(&num2), sizeof(num2)), inFile2.good());
-    // }
-
-    std::unique_lock<std::shared_mutex> cacheLock(cacheMutex);
-    size_t idxMax = bufferSize / sizeof(long long);
-    while(!inFile1.eof() && !inFile2.eof()){
-        inFile1.read(reinterpret_cast<char*>(buffer.get()), bufferSize);
-        inFile2.read(reinterpret_cast<char*>(buffer2.get()), bufferSize);
-        size_t idx1 = 0, idx2 = 0;
-        long long num1, num2;
-        while(idx1 < idxMax && idx2 < idxMax){
-            num1 = buffer[idx1];
-            num2 = buffer2[idx2];
-            if(num1 < num2){
-                idx1++;
-                outFile.write(reinterpret_cast<char*>(&num1), sizeof(num1));
-            }
-            else{
-                idx2++;
-                outFile.write(reinterpret_cast<char*>(&num2), sizeof(num2));
-            }
-        }
-        while(idx1 < idxMax){
-            num1 = buffer[idx1];
-            idx1++;
-            outFile.write(reinterpret_cast<char*>(&num1), sizeof(num1));
-        }
-        while(idx2 < idxMax){
-            num2 = buffer2[idx2];
-            idx2++;
-            outFile.write(reinterpret_cast<char*>(&num1), sizeof(num2));
-        }
-    }
-    while(!inFile1.eof()){
-        inFile1.read(reinterpret_cast<char*>(buffer.get()), idxMax);
-        size_t idx1 = 0;
-        long long num1;
-        while(idx1 < idxMax){
-            num1 = buffer[idx1];
-            idx1++;
-            outFile.write(reinterpret_cast<char*>(&num1), sizeof(num1));
+
+    // 两个输入各用mergeBuffer的一半，逐段读入后归并；合并不使用生成中间文件的buffer，可与各轮同时进行
+    std::lock_guard<std::mutex> mergeLock(mergeMutex);
+    size_t capacity = bufferSize / 2 / sizeof(long long); // 每个输入一次读入的个数
+    struct Input {
+        std::ifstream& file;
+        long long* data;
+        size_t size = 0; // 已读入的个数
+        size_t pos = 0; // 下一个未输出的位置
+    };
+    Input in1{inFile1, mergeBuffer.get()}, in2{inFile2, mergeBuffer.get() + capacity};
+    auto refill = [capacity](Input& in) { // 读入下一段，读完时返回false
+        in.file.read(reinterpret_cast<char*>(in.data), capacity * sizeof(long long));
+        in.size = in.file.gcount() / sizeof(long long);
+        in.pos = 0;
+        return in.size > 0;
+    };
+    bool has1 = refill(in1), has2 = refill(in2);
+    while (has1 && has2) {
+        Input& in = in1.data[in1.pos] <= in2.data[in2.pos] ? in1 : in2;
+        outFile.write(reinterpret_cast<const char*>(&in.data[in.pos]), sizeof(long long));
+        if (++in.pos == in.size) {
+            (&in == &in1 ? has1 : has2) = refill(in);
         }
     }
-    while(!inFile2.eof()){
-        inFile2.read(reinterpret_cast<char*>(buffer.get()), idxMax);
-        size_t idx2 = 0;
-        long long num2;
-        while(idx2 < idxMax){
-            num2 = buffer[idx2];
-            idx2++;
-            outFile.write(reinterpret_cast<char*>(&num2), sizeof(num2));
+    for (Input* in : {&in1, &in2}) { // 其中一个已读完，另一个剩下的部分直接写出
+        bool has = in == &in1 ? has1 : has2;
+        while (has) {
+            outFile.write(reinterpret_cast<const char*>(in->data + in->pos), (in->size - in->pos) * sizeof(long long));
+            has = refill(*in);
         }
     }
-    cacheLock.unlock();
 
     // 关闭文件
     inFile1.close();
@@ -396,19 +331,4 @@ void SortManager::MergeTwoIntermediate(size_t a, size_t b){ // 将中间文件a
     if (rename(outputFile.c_str(), newName.c_str()) != 0) {
         LOG("重命名文件失败: \n" + outputFile);
     }
-    std::unique_lock<std::mutex> lock(intermediateQueueMutex);
-    intermediateQueue.push(a);
-    lock.unlock();
-    runningMergeIntermediateCount.fetch_sub(1, std::memory_order_relaxed);
-    if(terminate.load()){
-        std::unique_lock<std::mutex> terminatelock(terminateMutex);
-        cvTerminate.notify_one();
-    }
-    
-    SetState(State::ReadyToMergeIntermediates);
-    cvTask.notify_one();
-}
-
-void SortManager::SetState(State newState){ //修改当前状态
-    state = newState;
 }
\ No newline at end of file
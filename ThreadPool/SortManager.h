@@ -1,6 +1,7 @@
 #ifndef SORTMANAGER_H
 #define SORTMANAGER_H
 
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <vector>
@@ -18,22 +19,12 @@
 
 namespace fs = std::filesystem;
 
+// 外部排序：逐轮把一缓存的数据读入、各线程建堆、合并堆生成有序的中间文件，同时按合并树两两合并已生成的中间文件。
+// 各阶段的先后由任务结果与任务组表达：Run()等待每一轮完成，合并树中两个子节点都完成的节点以低优先级提交
 class SortManager {
-public:
-    enum class State {
-        Running, // 运行中
-        ReadyToReadToCache, // 准备读取到缓存
-        ReadyToReadToHeaps, // 准备读取到堆
-        ReadyToMergeHeaps, // 准备合并堆
-        ReadyToMergeIntermediates, // 准备合并中间文件
-        Stop // 停止运行
-    };
 public:
     SortManager(const std::string& dir, size_t numThread, size_t bufferSize, size_t totalFileSize);
-    void Run();
-
-private:
-    void SetState(State newState);
+    void Run(); // 执行排序，任一阶段抛出的异常从这里抛出
 
 private:
     ThreadPool pool; // 线程池
@@ -41,7 +32,8 @@ private:
     
     std::shared_mutex cacheMutex;
     std::unique_ptr<long long[]> buffer; // 数据缓冲区
-    std::unique_ptr<long long []> buffer2;
+    std::mutex mergeMutex; // 合并中间文件共用mergeBuffer，依次进行
+    std::unique_ptr<long long[]> mergeBuffer; // 合并中间文件的缓冲区，两个输入各用一半
     
     size_t bufferSize; // buffer大小
     size_t blockSize; // 每个块的大小
@@ -50,9 +42,12 @@ private:
     void ReadToCache(); // 从文件中读取数据填满缓存
     //void ReadOneBlockToCache(); // 从文件中读一块数据到缓存
     void ReadToHeap(size_t i); // 把缓存数据读到堆中
+    void ReadToHeaps(); // 各线程并行把自己的一块缓存数据读到堆中，全部完成后返回
     void MergeHeaps(); // 将所有线程的堆合并成一个有序的中间文件
-    void MergeIntermediate(); // 将中间文件合并
+    size_t BuildMergeTree(size_t first, size_t count, size_t parent); // 为第first个起的count（至少为1）个中间文件建合并树，返回节点下标
+    void MergeNodeDone(TaskGroup& merges, size_t node); // 节点已完成；父节点的两个子节点都完成时提交父节点的合并
     void MergeTwoIntermediate(size_t a, size_t b); // 将两个中间文件合并
+    void MoveResult(size_t index); // 把最终的中间文件移到结果目录
 
     std::string interDir;
     fs::directory_iterator dirIter; // 目录迭代器
@@ -62,21 +57,18 @@ private:
     size_t totalFileSize; // 文件总共的大小
     size_t numIntermediate; // 中间文件个数
     
-    std::mutex stateMutex; 
-    State state; //状态
+    std::mutex intermediateQueueMutex; // 保护intermediates和合并树节点的pending
+    std::vector<size_t> intermediates; // 已生成的中间文件编号
 
-    std::mutex readyHeapsCountMutex;
-    std::atomic<size_t> readyHeapsCount; //就绪堆计数
-
-    std::mutex intermediateQueueMutex;
-    std::queue<size_t> intermediateQueue; // 中间文件队列
-
-    std::atomic<size_t> runningMergeIntermediateCount;
-    std::atomic<bool> terminate;
-
-    std::condition_variable cvTask; //条件变量
-    std::condition_variable cvTerminate; //条件变量
-    std::mutex terminateMutex;
+    struct MergeNode {
+        size_t first; // 覆盖的第一个中间文件，合并结果沿用它的编号
+        size_t left, right; // 子节点下标，叶子节点为NONE
+        size_t parent; // 父节点下标，根节点为NONE
+        size_t pending; // 尚未完成的子节点数
+    };
+    static const size_t NONE = SIZE_MAX;
+    std::vector<MergeNode> mergeTree; // 合并树，根节点下标为0
+    std::vector<size_t> leafNodes; // 第i个中间文件对应的叶子节点
 };
 
 #endif // SORTMANAGER_H
\ No newline at end of file
@@ -0,0 +1,174 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只能移动的任务：不超过INLINE_SIZE字节、且移动不抛异常的可调用对象直接存放在对象内部，不分配内存；
+// 更大的可调用对象才在堆上分配。对象按缓存行对齐、恰好占一个缓存行，不同线程使用的相邻任务槽不会伪共享
+class alignas(64) Task {
+public:
+    static const size_t INLINE_SIZE = 48; // 内部存储的大小，够放6个指针的捕获
+
+    Task() noexcept = default;
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& f) {
+        typedef std::decay_t<F> Fn;
+        if constexpr (fitsInline<Fn>()) {
+            new (storage) Fn(std::forward<F>(f));
+            ops = &InlineOps<Fn>::table;
+        } else {
+            *reinterpret_cast<Fn**>(storage) = new Fn(std::forward<F>(f));
+            ops = &HeapOps<Fn>::table;
+        }
+    }
+    Task(Task&& other) noexcept {
+        moveFrom(other);
+    }
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
+
+    void operator()() { ops->invoke(storage); }
+    explicit operator bool() const { return ops != nullptr; }
+    void reset() { // 销毁其中的可调用对象，变为空任务
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    template <typename Fn>
+    static constexpr bool fitsInline() {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Fn>;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src); // 移动到dst并销毁src中的对象
+        void (*destroy)(void* storage);
+    };
+
+    template <typename Fn>
+    struct InlineOps {
+        static void invoke(void* storage) { (*static_cast<Fn*>(storage))(); }
+        static void move(void* dst, void* src) {
+            new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+            static_cast<Fn*>(src)->~Fn();
+        }
+        static void destroy(void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+        static constexpr Ops table = {invoke, move, destroy};
+    };
+
+    template <typename Fn>
+    struct HeapOps { // storage中只存放指针
+        static void invoke(void* storage) { (**static_cast<Fn**>(storage))(); }
+        static void move(void* dst, void* src) { *static_cast<Fn**>(dst) = *static_cast<Fn**>(src); }
+        static void destroy(void* storage) { delete *static_cast<Fn**>(storage); }
+        static constexpr Ops table = {invoke, move, destroy};
+    };
+
+    void moveFrom(Task& other) noexcept {
+        if (other.ops) {
+            other.ops->move(storage, other.storage);
+            ops = other.ops;
+            other.ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    const Ops* ops = nullptr;
+};
+
+static_assert(sizeof(Task) == 64, "Task should occupy exactly one cache line");
+
+// 预先分配的任务槽，空闲槽的序号放在一个有界的多生产者多消费者环形队列中（Vyukov的算法），
+// 取出和归还各一次CAS，不分配内存
+class TaskSlots {
+public:
+    explicit TaskSlots(size_t capacity) { // capacity向上取整为2的幂
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        slots.reset(new Task[size]); // C++17的new按Task的64字节对齐分配，每个槽独占一个缓存行
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++) { // 开始时所有槽都空闲
+            cells[i].sequence.store(i + 1, std::memory_order_relaxed);
+            cells[i].index = i;
+        }
+        enqueuePos.store(size, std::memory_order_relaxed);
+        dequeuePos.store(0, std::memory_order_relaxed);
+    }
+    TaskSlots(const TaskSlots&) = delete;
+    TaskSlots& operator=(const TaskSlots&) = delete;
+
+    Task* acquire() { // 取一个空闲槽，没有空闲槽时返回nullptr
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    size_t index = cell.index;
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return &slots[index];
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void release(Task* slot) { // 归还acquire()取出的槽，槽中的任务需已清空
+        size_t index = slot - slots.get();
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.index = index;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else {
+                // 槽数与队列容量相同，归还时队列不会满；diff < 0只是其他线程的出队尚未完成
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool owns(const Task* slot) const { // 是否是本对象的槽（否则是槽用完时在堆上分配的）
+        return slot >= slots.get() && slot <= slots.get() + mask;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence; // 等于位置 + 1时可出队，等于位置时可入队
+        size_t index; // 空闲槽的序号
+    };
+    std::unique_ptr<Task[]> slots;
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos; // 归还端
+    alignas(64) std::atomic<size_t> dequeuePos; // 取出端
+};
+
+#endif // TASK_H
@@ -0,0 +1,220 @@
+#ifndef TASKFUTURE_H
+#define TASKFUTURE_H
+
+// 任务结果、延续与任务组。由ThreadPool.h在ThreadPool定义之后包含，不单独使用
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class Future;
+
+// then(f)中f的返回类型：以T为参数，T为void时无参数
+template <typename T, typename F>
+struct ContinuationResult {
+    typedef std::invoke_result_t<F&, T&&> type;
+};
+template <typename F>
+struct ContinuationResult<void, F> {
+    typedef std::invoke_result_t<F&> type;
+};
+
+// 两个优先级中较低的一个
+inline TaskPriority lowerPriority(TaskPriority a, TaskPriority b) {
+    return a > b ? a : b;
+}
+
+// 任务结果的共享状态：结果或异常只设置一次，设置后依次提交登记的延续
+template <typename T>
+struct FutureState {
+    typedef std::conditional_t<std::is_void_v<T>, char, T> Storage; // void任务不存值
+
+    FutureState(ThreadPool* pool, TaskPriority priority) : pool(pool), priority(priority) {}
+
+    template <typename... Args>
+    void setValue(Args&&... args) {
+        value.emplace(std::forward<Args>(args)...);
+        complete();
+    }
+    void setError(std::exception_ptr e) {
+        error = e;
+        complete();
+    }
+    void complete() { // 标记完成，唤醒等待者并提交延续
+        std::vector<std::pair<Task, TaskPriority>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.store(true, std::memory_order_release);
+            pending.swap(continuations);
+        }
+        cv.notify_all();
+        for (auto& continuation : pending) {
+            pool->addTask(std::move(continuation.first), continuation.second);
+        }
+    }
+    void onReady(Task continuation, TaskPriority priority) { // 完成后以priority提交continuation，已完成时立即提交
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready.load(std::memory_order_relaxed)) {
+                continuations.emplace_back(std::move(continuation), priority);
+                return;
+            }
+        }
+        pool->addTask(std::move(continuation), priority);
+    }
+    // 在本线程池的工作线程中等待时，先执行其他任务，避免所有工作线程都在等待而死锁。
+    // 只执行不低于当前任务优先级的任务；所等待的任务优先级更低时放宽到它的优先级，否则它可能无人执行
+    void wait() {
+        while (!ready.load(std::memory_order_acquire)) {
+            if (pool->runPendingTask(lowerPriority(pool->currentPriority(), priority))) continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return ready.load(std::memory_order_relaxed); });
+        }
+    }
+
+    ThreadPool* pool;
+    TaskPriority priority; // 完成该结果之前要执行的任务中最低的优先级
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> ready{false};
+    std::optional<Storage> value;
+    std::exception_ptr error;
+    std::vector<std::pair<Task, TaskPriority>> continuations; // 完成前登记的延续及其优先级
+};
+
+// 调用f(args...)，把返回值或抛出的异常存入state
+template <typename T, typename F, typename... Args>
+void fulfill(FutureState<T>& state, F& f, Args&&... args) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            f(std::forward<Args>(args)...);
+            state.setValue();
+        } else {
+            state.setValue(f(std::forward<Args>(args)...));
+        }
+    }
+    catch (...) {
+        state.setError(std::current_exception());
+    }
+}
+
+// 任务结果，由ThreadPool::submit()或then()返回，可移动不可复制
+template <typename T>
+class Future {
+public:
+    Future() = default;
+    explicit Future(std::shared_ptr<FutureState<T>> state) : state(std::move(state)) {}
+    Future(Future&&) = default;
+    Future& operator=(Future&&) = default;
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    bool valid() const { return state != nullptr; } // get()或then()之后不再有效
+    bool ready() const { return state->ready.load(std::memory_order_acquire); } // 是否已完成
+    void wait() const { state->wait(); } // 等待完成；在工作线程中调用时，等待期间执行其他任务
+
+    T get() { // 等待并取出结果，任务抛出的异常在这里重新抛出
+        std::shared_ptr<FutureState<T>> s = std::move(state);
+        s->wait();
+        if (s->error) std::rethrow_exception(s->error);
+        if constexpr (!std::is_void_v<T>) return std::move(*s->value);
+    }
+
+    // 完成后以结果为参数（void任务无参数）在线程池中以priority执行f，返回f的结果；任务失败时不执行f，异常传给返回的Future
+    template <typename F>
+    auto then(F&& f, TaskPriority priority = TaskPriority::Normal) {
+        typedef std::decay_t<F> Fn;
+        typedef typename ContinuationResult<T, Fn>::type U;
+        std::shared_ptr<FutureState<T>> s = std::move(state);
+        auto next = std::make_shared<FutureState<U>>(s->pool, lowerPriority(s->priority, priority));
+        s->onReady([s, next, fn = Fn(std::forward<F>(f))]() mutable {
+            if (s->error) {
+                next->setError(s->error);
+            } else if constexpr (std::is_void_v<T>) {
+                fulfill(*next, fn);
+            } else {
+                fulfill(*next, fn, std::move(*s->value));
+            }
+        }, priority);
+        return Future<U>(next);
+    }
+
+private:
+    std::shared_ptr<FutureState<T>> state;
+};
+
+template <typename F>
+auto ThreadPool::submit(F&& f, TaskPriority priority) {
+    typedef std::decay_t<F> Fn;
+    typedef std::invoke_result_t<Fn&> T;
+    auto state = std::make_shared<FutureState<T>>(this, priority);
+    addTask([state, fn = Fn(std::forward<F>(f))]() mutable { fulfill(*state, fn); }, priority);
+    return Future<T>(state);
+}
+
+// 任务组：run()添加的任务全部完成后wait()返回，并重新抛出第一个异常。析构时等待但不抛出
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {}
+    ~TaskGroup() {
+        try {
+            wait();
+        }
+        catch (...) {
+        }
+    }
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template <typename F>
+    void run(F&& f, TaskPriority priority = TaskPriority::Normal) {
+        pending.fetch_add(1);
+        TaskPriority seen = lowest.load();
+        while (seen < priority && !lowest.compare_exchange_weak(seen, priority)) {
+        }
+        pool.addTask([this, fn = std::decay_t<F>(std::forward<F>(f))]() mutable {
+            try {
+                fn();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+            // 持锁减少计数：wait()返回前会再取一次锁，保证这里已不再访问任务组
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.fetch_sub(1) == 1) cv.notify_all();
+        }, priority);
+    }
+
+    void wait() { // 等待期间在工作线程中执行其他任务，优先级的限制与FutureState::wait()相同
+        while (pending.load() > 0) {
+            if (pool.runPendingTask(lowerPriority(pool.currentPriority(), lowest.load()))) continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return pending.load() == 0; });
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    ThreadPool& pool;
+    std::atomic<size_t> pending{0}; // 尚未完成的任务数
+    std::atomic<TaskPriority> lowest{TaskPriority::High}; // run()添加过的任务中最低的优先级
+    std::mutex mutex; // 保护error，配合cv
+    std::condition_variable cv; // 任务全部完成时通知
+    std::exception_ptr error; // 第一个异常
+};
+
+#endif // TASKFUTURE_H
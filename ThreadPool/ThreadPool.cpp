@@ -1,48 +1,236 @@
 #include "ThreadPool.h"
 
+static thread_local ThreadPool* currentPool = nullptr; // 当前线程所属的线程池，非工作线程为nullptr
+static thread_local size_t currentIndex = 0; // 当前线程在线程池中的序号
+static thread_local uint64_t currentSeed = 0; // 当前线程窃取时的随机数状态
+static thread_local size_t currentPicks = 0; // 当前线程取到任务的次数，用于周期轮询低优先级
+static thread_local size_t currentTaskPriority = ThreadPool::PRIORITY_COUNT - 1; // 当前线程正在执行的任务的优先级
+
+const size_t ThreadPool::DEFAULT_TASK_SLOTS;
+const size_t ThreadPool::IDLE_SPINS;
+const size_t ThreadPool::IDLE_YIELDS;
+const size_t ThreadPool::PRIORITY_COUNT;
+const size_t ThreadPool::LOW_POLL_PERIOD;
+
+static inline void cpuRelax() { // 自旋等待提示，降低自旋时的功耗并让出超线程的执行资源
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
 // 构造函数
-ThreadPool::ThreadPool(size_t threads) {
-    for (size_t i = 0; i < threads; ++i) {
-        workers.emplace_back([this]() { this->workerRun(); }); // 创建工作线程并启动
+ThreadPool::ThreadPool(size_t threads, size_t taskSlots) : slots(taskSlots) {
+    for (size_t i = 0; i < threads; ++i) { // 先建好所有队列，工作线程启动后就可能互相窃取
+        for (size_t p = 0; p < PRIORITY_COUNT; p++) {
+            localQueues.emplace_back(new WorkStealingDeque<Task>());
+        }
         heaps.push_back(Heap());
     }
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() { this->workerRun(i); }); // 创建工作线程并启动
+    }
 }
 
-void ThreadPool::addTask(std::function<void()> func){
-    std::lock_guard<std::mutex> lock(queueMutex);
-    taskQueue.push(func);
+void ThreadPool::GlobalQueue::push(Task* task) {
+    size_t n = count.load(std::memory_order_relaxed);
+    if (n == tasks.size()) { // 队列已满：按顺序搬到两倍大的数组中
+        std::vector<Task*> larger(tasks.size() * 2);
+        for (size_t i = 0; i < n; i++) {
+            larger[i] = tasks[(head + i) % tasks.size()];
+        }
+        tasks.swap(larger);
+        head = 0;
+    }
+    tasks[(head + n) % tasks.size()] = task;
+    count.fetch_add(1, std::memory_order_release);
 }
 
-// 工作线程执行的函数
-void ThreadPool::workerRun() {
-    while (!stop.load()) { // 检查是否需要停止
-        std::function<void()> func;
-        {
-            std::lock_guard<std::mutex> lock(queueMutex); // 上锁以安全地访问任务队列
-            
-            if (!taskQueue.empty()) { // 从队列中取出任务
-                func = taskQueue.front();
-                taskQueue.pop();
+Task* ThreadPool::GlobalQueue::pop() {
+    if (count.load(std::memory_order_relaxed) == 0) return nullptr;
+    Task* task = tasks[head];
+    head = (head + 1) % tasks.size();
+    count.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+void ThreadPool::schedule(Task* task, size_t priority){
+    if (priority != static_cast<size_t>(TaskPriority::Normal)) queued[priority].fetch_add(1, std::memory_order_relaxed);
+    if (currentPool == this) { // 任务中添加的子任务：放入本线程的队列，无需加锁
+        localQueue(currentIndex, priority).push(task);
+    } else {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        globalQueues[priority].push(task);
+    }
+    wakeOne();
+}
+
+void ThreadPool::runTask(Task* task, size_t priority) {
+    size_t outer = currentTaskPriority; // 等待中执行的任务结束后恢复
+    currentTaskPriority = priority;
+    (*task)(); // 执行任务
+    currentTaskPriority = outer;
+    discardTask(task);
+}
+
+void ThreadPool::discardTask(Task* task) {
+    if (slots.owns(task)) {
+        task->reset(); // 先销毁捕获的对象，槽才能被其他线程复用
+        slots.release(task);
+    } else {
+        delete task;
+    }
+}
+
+void ThreadPool::wakeOne() {
+    // 与waitForTask()中先登记再找任务配对：要么这里看到正在找任务或休眠的线程，要么它们看到新任务
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (searching.load(std::memory_order_relaxed) > 0) return; // 正在自旋找任务的线程会取走它
+    if (sleepers.load(std::memory_order_relaxed) == 0) return; // 所有线程都在运行，无需系统调用
+    std::lock_guard<std::mutex> lock(idleMutex);
+    if (wakeups < sleepers.load(std::memory_order_relaxed)) {
+        wakeups++;
+        idleCv.notify_one();
+    }
+}
+
+bool ThreadPool::hasQueuedTasks() {
+    for (auto& queue : globalQueues) {
+        if (queue.count.load(std::memory_order_relaxed) > 0) return true;
+    }
+    for (auto& queue : localQueues) {
+        if (!queue->empty()) return true;
+    }
+    return false;
+}
+
+Task* ThreadPool::waitForTask(size_t index, uint64_t& seed, size_t& priority) {
+    while (!stop.load()) {
+        // 任务往往很快就到，先自旋以免休眠与唤醒的开销。自旋期间添加任务不必唤醒其他线程
+        searching.fetch_add(1);
+        for (size_t i = 0; i < IDLE_SPINS + IDLE_YIELDS; i++) {
+            if (i < IDLE_SPINS) {
+                cpuRelax();
+            } else {
+                std::this_thread::yield(); // CPU被占满时让添加任务的线程有机会运行
+            }
+            if (Task* task = findTask(index, seed, priority)) {
+                // 最后一个找任务的线程开始执行任务，还有任务排队时唤醒下一个，逐步让更多线程参与
+                if (searching.fetch_sub(1) == 1 && hasQueuedTasks()) wakeOne();
+                return task;
             }
         }
+        searching.fetch_sub(1);
 
-        if (func) { 
-            func(); // 执行任务
-        } 
-        else {
-            std::this_thread::yield(); // 如果队列为空，放弃当前时间片，避免忙等待
+        std::unique_lock<std::mutex> lock(idleMutex);
+        sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Task* task = findTask(index, seed, priority); // 登记休眠后再检查一次，避免错过刚添加的任务
+        if (!task) {
+            idleCv.wait(lock, [this]() { return wakeups > 0 || stop.load(); });
+            if (wakeups > 0) wakeups--;
         }
+        sleepers.fetch_sub(1);
+        if (task) return task;
+        // 被唤醒后回到自旋状态找任务
+    }
+    return nullptr;
+}
+
+Task* ThreadPool::findTask(size_t index, uint64_t& seed, size_t& priority, size_t lowest) {
+    bool poll = (currentPicks + 1) % LOW_POLL_PERIOD == 0; // 这一次从低优先级找起
+    for (size_t i = 0; i <= lowest; i++) {
+        priority = poll ? lowest - i : i;
+        bool counted = priority != static_cast<size_t>(TaskPriority::Normal);
+        if (counted && queued[priority].load(std::memory_order_relaxed) == 0) continue;
+        if (Task* task = findTaskAt(index, seed, priority)) {
+            if (counted) queued[priority].fetch_sub(1, std::memory_order_relaxed);
+            currentPicks++;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+Task* ThreadPool::findTaskAt(size_t index, uint64_t& seed, size_t priority) {
+    Task* task = nullptr;
+    WorkStealingDeque<Task>& local = localQueue(index, priority);
+    if (!local.empty()) { // 所属线程看到的底部是准确的，先检查可省去空队列pop()中的屏障
+        task = local.pop();
+        if (task) return task;
+    }
+
+    GlobalQueue& global = globalQueues[priority];
+    if (global.count.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        task = global.pop();
+        if (task) return task;
+    }
+
+    // 从随机位置开始依次尝试窃取其他线程的任务（xorshift64）
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    size_t n = localQueues.size() / PRIORITY_COUNT; // workers在构造期间仍在增长，不能用它的大小
+    size_t start = seed % n;
+    for (size_t i = 0; i < n; i++) {
+        size_t victim = (start + i) % n;
+        if (victim == index || localQueue(victim, priority).empty()) continue; // 先不加屏障地检查，跳过空队列
+        task = localQueue(victim, priority).steal();
+        if (task) return task;
+    }
+    return nullptr;
+}
+
+// 工作线程执行的函数
+void ThreadPool::workerRun(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+    uint64_t& seed = currentSeed;
+    seed = index * 0x9E3779B97F4A7C15ULL + 1; // 各线程的窃取顺序不同
+    while (!stop.load()) { // 检查是否需要停止
+        size_t priority;
+        Task* task = findTask(index, seed, priority);
+        if (!task) {
+            task = waitForTask(index, seed, priority); // 没有任务时自旋后休眠，不占用CPU
+            if (!task) break;
+        }
+        runTask(task, priority);
     }
 }
 
 // 析构函数
 ThreadPool::~ThreadPool() {
     stop.store(true); // 设置停止标志
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        idleCv.notify_all(); // 唤醒所有休眠的线程
+    }
     for (std::thread &worker : workers) {
         if (worker.joinable()) {
             worker.join(); // 等待所有工作线程完成
         }
     }
+    for (auto& queue : localQueues) { // 释放尚未执行的任务
+        while (Task* task = queue->pop()) discardTask(task);
+    }
+    for (auto& queue : globalQueues) {
+        while (Task* task = queue.pop()) discardTask(task);
+    }
+}
+
+bool ThreadPool::runPendingTask(TaskPriority minPriority) {
+    if (currentPool != this) return false;
+    size_t priority;
+    Task* task = findTask(currentIndex, currentSeed, priority, static_cast<size_t>(minPriority));
+    if (!task) return false;
+    runTask(task, priority);
+    return true;
+}
+
+TaskPriority ThreadPool::currentPriority() const {
+    return currentPool == this ? static_cast<TaskPriority>(currentTaskPriority) : TaskPriority::Low;
 }
 
 bool ThreadPool::ifStop(){
@@ -51,4 +239,4 @@ bool ThreadPool::ifStop(){
 
 std::thread& ThreadPool::getThread(size_t i){
     return workers[i];
-}
\ No newline at end of file
+}
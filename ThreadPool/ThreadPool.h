@@ -5,30 +5,101 @@
 #include <vector>
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <queue>
 #include <mutex>
+#include <condition_variable>
 #include "Heap.h"
+#include "Task.h"
+#include "WorkStealingDeque.h"
 
-// 线程池类
+template <typename T>
+class Future;
+
+// 任务的优先级：工作线程先取高优先级的任务，同一优先级内按原来的顺序
+enum class TaskPriority {
+    High = 0, // 关键路径上的任务
+    Normal = 1, // 默认
+    Low = 2 // 后台任务
+};
+
+// 线程池类：工作窃取调度。每个工作线程有自己的任务队列，任务中添加的子任务放入本线程的队列（后进先出），
+// 空闲时先取全局队列中外部添加的任务，再随机选择其他线程窃取其最早的任务。
+// 找不到任务时先短暂自旋，再在条件变量上休眠，添加任务时只唤醒一个休眠的线程。
+// 任务存放在预先分配的任务槽中，捕获不超过Task::INLINE_SIZE时，添加和执行任务都不分配内存。
+// 每个优先级有各自的本线程队列和全局队列，找任务时从高到低；每取LOW_POLL_PERIOD次任务有一次从低到高轮询，
+// 高优先级的任务持续到来时低优先级的任务也能执行。这是按取任务次数的周期轮询，不按任务排队的时间老化。
+// 工作线程在等待中执行其他任务时，只取不低于指定优先级的任务，高优先级的等待不会被长时间的低优先级任务拖住
 class ThreadPool {
 private:
     std::function<void()> func; // 使用 std::function 来存储可调用对象
     
 public:
-    ThreadPool(size_t threads); // 构造函数
-    ~ThreadPool(); // 析构函数
+    static const size_t DEFAULT_TASK_SLOTS = 4096; // 默认的任务槽数
+
+    ThreadPool(size_t threads, size_t taskSlots = DEFAULT_TASK_SLOTS); // 构造函数，taskSlots为同时排队或执行的任务数上限，超过时在堆上分配
+    ~ThreadPool(); // 析构函数，尚未执行的任务被丢弃
 
-    void addTask(std::function<void()> func); // 添加任务
+    template <typename F>
+    void addTask(F&& func, TaskPriority priority = TaskPriority::Normal) { // 添加任务，func为无参的可调用对象
+        Task* task = slots.acquire();
+        if (task) {
+            *task = Task(std::forward<F>(func));
+        } else {
+            task = new Task(std::forward<F>(func)); // 任务槽用完时在堆上分配
+        }
+        schedule(task, static_cast<size_t>(priority));
+    }
+    // 提交任意无参可调用对象，返回其结果；任务抛出的异常在Future::get()时重新抛出。定义在TaskFuture.h中
+    template <typename F>
+    auto submit(F&& f, TaskPriority priority = TaskPriority::Normal);
+    // 在本线程池的工作线程中调用时，取一个优先级不低于minPriority的任务执行并返回true；没有这样的任务或不是工作线程时返回false
+    bool runPendingTask(TaskPriority minPriority = TaskPriority::Low);
+    TaskPriority currentPriority() const; // 本线程池的工作线程正在执行的任务的优先级，其他线程为Low
     std::thread& getThread(size_t i); // 获取某个线程
     bool ifStop(); // 如果停止
+    size_t size() const { return workers.size(); } // 工作线程数
     std::vector<Heap> heaps;
+
+    static const size_t IDLE_SPINS = 64; // 休眠前自旋找任务的次数
+    static const size_t IDLE_YIELDS = 8; // 自旋之后、休眠之前让出CPU再找任务的次数
+    static const size_t PRIORITY_COUNT = 3; // 优先级的个数
+    static const size_t LOW_POLL_PERIOD = 16; // 每取这么多次任务，有一次先找低优先级的任务
 private:
-    void workerRun(); // 工作线程执行的函数
-    std::queue<std::function<void()>> taskQueue; // 无锁任务队列
+    struct GlobalQueue { // 全局队列：非工作线程添加的任务，环形使用，满时翻倍，由queueMutex保护
+        std::vector<Task*> tasks = std::vector<Task*>(64);
+        size_t head = 0; // 队首位置
+        std::atomic<size_t> count{0}; // 任务数，为0时工作线程不加锁
+        void push(Task* task);
+        Task* pop();
+    };
+
+    void schedule(Task* task, size_t priority); // 把任务放入本线程或全局队列，并按需唤醒工作线程
+    void runTask(Task* task, size_t priority); // 以priority为当前优先级执行任务并归还任务槽
+    void discardTask(Task* task); // 不执行，直接归还任务槽
+    void workerRun(size_t index); // 工作线程执行的函数
+    Task* findTask(size_t index, uint64_t& seed, size_t& priority, size_t lowest = PRIORITY_COUNT - 1); // 按优先级依次找不低于lowest的任务，priority返回取到的任务的优先级
+    Task* findTaskAt(size_t index, uint64_t& seed, size_t priority); // 依次从本线程队列、全局队列和其他线程的队列中取该优先级的任务
+    WorkStealingDeque<Task>& localQueue(size_t index, size_t priority) { return *localQueues[index * PRIORITY_COUNT + priority]; }
+    Task* waitForTask(size_t index, uint64_t& seed, size_t& priority); // 自旋后休眠，直到找到任务；停止时返回nullptr
+    void wakeOne(); // 没有线程在找任务、且有线程休眠时唤醒一个
+    bool hasQueuedTasks(); // 是否还有排队的任务（近似值）
+    TaskSlots slots; // 预先分配的任务槽
+    std::vector<std::unique_ptr<WorkStealingDeque<Task>>> localQueues; // 每个工作线程每个优先级一个任务队列
+    GlobalQueue globalQueues[PRIORITY_COUNT]; // 每个优先级一个全局队列
+    std::atomic<size_t> queued[PRIORITY_COUNT] = {}; // 高、低优先级排队的任务数，为0时找任务跳过该优先级；普通优先级不计数，默认路径不多一次原子操作
     std::vector<std::thread> workers; // 工作线程集合
     std::atomic<bool> stop{false}; // 停止标志
 
-    std::mutex queueMutex;
+    std::mutex queueMutex; // 保护全局队列的tasks和head
+
+    std::mutex idleMutex; // 保护wakeups，配合idleCv
+    std::condition_variable idleCv; // 添加任务或停止时通知
+    std::atomic<size_t> searching{0}; // 正在自旋找任务的线程数
+    std::atomic<size_t> sleepers{0}; // 准备休眠或正在休眠的线程数
+    size_t wakeups = 0; // 已发出、尚未被休眠线程领取的唤醒数，不超过sleepers
 };
 
-#endif // THREADPOOL_H
\ No newline at end of file
+#include "TaskFuture.h"
+
+#endif // THREADPOOL_H
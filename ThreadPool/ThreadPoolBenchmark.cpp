@@ -0,0 +1,378 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <ctime>
+#include <cstdlib>
+#include <new>
+#include "ThreadPool.h"
+
+const size_t EMPTY_TASKS = 1000000; // 空任务数
+const size_t FORK_DEPTH = 19; // 分叉-合并树的深度，共2^20 - 1个任务
+const size_t THREAD_COUNTS[] = {1, 2, 4, 8, 16, 32, 64};
+const size_t IDLE_THREADS = 8; // 空闲与唤醒测试的线程数
+const int IDLE_MS = 1000; // 空闲测试的时长
+const size_t WAKE_SAMPLES = 1000; // 唤醒延迟的采样次数
+const size_t ALLOC_THREADS = 4; // 分配次数测试的线程数
+const size_t ALLOC_BATCH = 1000; // 每批添加的任务数，每批执行完再添加下一批
+const size_t ALLOC_BATCHES = 1000; // 批数
+const size_t PRIORITY_THREADS = 4; // 优先级测试的线程数
+const size_t PRIORITY_BACKLOG = 20000; // 先排队的后台任务数
+const int TASK_US = 20; // 优先级测试中每个任务的执行时间
+const size_t PROBE_COUNT = 100; // 探测任务数
+const int STARVE_MS = 200; // 高优先级任务占满线程池的时长
+const int WAIT_CHILD_MS = 20; // 等待测试中高优先级子任务的执行时间
+const int WAIT_LOW_MS = 100; // 等待测试中排队的低优先级任务的执行时间
+
+static std::atomic<size_t> allocations{0}; // 全局operator new的调用次数
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t size, std::align_val_t align) { // Task按缓存行对齐，任务槽用完时走这个版本
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+// 原来的线程池：所有线程共用一个加锁的队列，空闲时yield，作为对比基准
+class QueuePool {
+public:
+    QueuePool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([this]() { this->workerRun(); });
+        }
+    }
+    ~QueuePool() {
+        stop.store(true);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+    void addTask(std::function<void()> func) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        taskQueue.push(func);
+    }
+private:
+    void workerRun() {
+        while (!stop.load()) {
+            std::function<void()> func;
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (!taskQueue.empty()) {
+                    func = taskQueue.front();
+                    taskQueue.pop();
+                }
+            }
+            if (func) {
+                func();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    std::queue<std::function<void()>> taskQueue;
+    std::vector<std::thread> workers;
+    std::atomic<bool> stop{false};
+    std::mutex queueMutex;
+};
+
+void waitFor(std::atomic<size_t>& remaining) { // 等待所有任务执行完
+    while (remaining.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+// 添加EMPTY_TASKS个空任务并等待执行完，返回每秒执行的任务数。
+// spawned为false时由主线程添加，为true时由线程池中的一个任务添加
+template <typename Pool>
+double runEmptyTasks(size_t threads, bool spawned) {
+    Pool pool(threads);
+    std::atomic<size_t> remaining{EMPTY_TASKS};
+    auto start = std::chrono::high_resolution_clock::now();
+    auto spawn = [&pool, &remaining]() {
+        for (size_t i = 0; i < EMPTY_TASKS; i++) {
+            pool.addTask([&remaining]() { remaining.fetch_sub(1); });
+        }
+    };
+    if (spawned) {
+        pool.addTask(spawn);
+    } else {
+        spawn();
+    }
+    waitFor(remaining);
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    return EMPTY_TASKS / duration.count();
+}
+
+// 分叉-合并树的一个节点：深度大于0时添加两个子任务
+template <typename Pool>
+void forkNode(Pool& pool, size_t depth, std::atomic<size_t>& remaining) {
+    if (depth > 0) {
+        pool.addTask([&pool, depth, &remaining]() { forkNode(pool, depth - 1, remaining); });
+        pool.addTask([&pool, depth, &remaining]() { forkNode(pool, depth - 1, remaining); });
+    }
+    remaining.fetch_sub(1);
+}
+
+// 从根节点开始执行整棵树并等待执行完，返回每秒执行的任务数
+template <typename Pool>
+double runForkJoin(size_t threads) {
+    Pool pool(threads);
+    size_t total = (size_t(1) << (FORK_DEPTH + 1)) - 1;
+    std::atomic<size_t> remaining{total};
+    auto start = std::chrono::high_resolution_clock::now();
+    pool.addTask([&pool, &remaining]() { forkNode(pool, FORK_DEPTH, remaining); });
+    waitFor(remaining);
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    return total / duration.count();
+}
+
+double processCpuSeconds() { // 本进程所有线程消耗的CPU时间
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 线程池空闲IDLE_MS毫秒，返回期间平均占用的CPU核数
+template <typename Pool>
+double runIdle() {
+    Pool pool(IDLE_THREADS);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10)); // 等工作线程进入空闲状态
+    double cpuStart = processCpuSeconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MS));
+    return (processCpuSeconds() - cpuStart) * 1000 / IDLE_MS;
+}
+
+// 每隔1ms添加一个任务，记录从添加到开始执行的延迟（us），返回排序后的结果
+template <typename Pool>
+std::vector<double> runWakeLatency() {
+    Pool pool(IDLE_THREADS);
+    std::vector<double> latencies;
+    for (size_t i = 0; i < WAKE_SAMPLES; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // 让工作线程进入空闲状态
+        std::promise<std::chrono::high_resolution_clock::time_point> started;
+        auto submitted = std::chrono::high_resolution_clock::now();
+        pool.addTask([&started]() { started.set_value(std::chrono::high_resolution_clock::now()); });
+        latencies.push_back(std::chrono::duration<double, std::micro>(started.get_future().get() - submitted).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+struct AllocResult {
+    double allocsPerTask;
+    double nsPerTask;
+};
+
+// 分批添加ALLOC_BATCHES * ALLOC_BATCH个任务，每批等执行完再添加下一批，统计稳定状态下每个任务的分配次数和耗时。
+// payload为任务捕获的额外字节数：0时只捕获一个指针，32时捕获共40字节，超过std::function的内部存储
+template <typename Pool, size_t payload>
+AllocResult runAllocBatches() {
+    Pool pool(ALLOC_THREADS);
+    std::atomic<size_t> remaining{0};
+    std::array<char, payload> data{};
+    auto batch = [&]() {
+        remaining.store(ALLOC_BATCH);
+        for (size_t i = 0; i < ALLOC_BATCH; i++) {
+            if constexpr (payload == 0) {
+                pool.addTask([&remaining]() { remaining.fetch_sub(1); });
+            } else {
+                pool.addTask([&remaining, data]() { remaining.fetch_sub(1 + data[0]); });
+            }
+        }
+        waitFor(remaining);
+    };
+    batch(); // 预热：队列等结构先扩容到稳定大小
+    size_t allocStart = allocations.load();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < ALLOC_BATCHES; i++) {
+        batch();
+    }
+    std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+    size_t tasks = ALLOC_BATCHES * ALLOC_BATCH;
+    return {double(allocations.load() - allocStart) / tasks, duration.count() / tasks};
+}
+
+// 分叉-合并树的分配次数和每个任务的耗时，先执行一次预热
+template <typename Pool>
+AllocResult runAllocForkJoin() {
+    Pool pool(ALLOC_THREADS);
+    size_t total = (size_t(1) << (FORK_DEPTH + 1)) - 1;
+    std::atomic<size_t> remaining{total};
+    pool.addTask([&pool, &remaining]() { forkNode(pool, FORK_DEPTH, remaining); });
+    waitFor(remaining);
+    remaining.store(total);
+    size_t allocStart = allocations.load();
+    auto start = std::chrono::high_resolution_clock::now();
+    pool.addTask([&pool, &remaining]() { forkNode(pool, FORK_DEPTH, remaining); });
+    waitFor(remaining);
+    std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+    return {double(allocations.load() - allocStart) / total, duration.count() / total};
+}
+
+void spinFor(int us) { // 忙等us微秒，模拟计算任务
+    auto end = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::high_resolution_clock::now() < end) {
+    }
+}
+
+// 先添加PRIORITY_BACKLOG个后台任务，再每隔100us添加一个探测任务，返回探测任务从添加到开始执行的延迟（us），已排序
+std::vector<double> runPriorityLatency(TaskPriority backlog, TaskPriority probe) {
+    ThreadPool pool(PRIORITY_THREADS, PRIORITY_BACKLOG + PROBE_COUNT);
+    std::atomic<size_t> remaining{PRIORITY_BACKLOG + PROBE_COUNT};
+    for (size_t i = 0; i < PRIORITY_BACKLOG; i++) {
+        pool.addTask([&remaining]() { spinFor(TASK_US); remaining.fetch_sub(1); }, backlog);
+    }
+    std::vector<std::chrono::high_resolution_clock::time_point> submitted(PROBE_COUNT), started(PROBE_COUNT);
+    for (size_t i = 0; i < PROBE_COUNT; i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        submitted[i] = std::chrono::high_resolution_clock::now();
+        pool.addTask([&started, &remaining, i]() { started[i] = std::chrono::high_resolution_clock::now(); remaining.fetch_sub(1); }, probe);
+    }
+    waitFor(remaining);
+    std::vector<double> latencies;
+    for (size_t i = 0; i < PROBE_COUNT; i++) {
+        latencies.push_back(std::chrono::duration<double, std::micro>(started[i] - submitted[i]).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+// 低优先级任务排队时，让高优先级任务执行完再添加自己，占满线程池STARVE_MS毫秒，返回期间执行完的低优先级任务数
+size_t runStarvation() {
+    ThreadPool pool(PRIORITY_THREADS, PRIORITY_BACKLOG + PRIORITY_THREADS * 2);
+    std::atomic<size_t> lowDone{0};
+    std::atomic<bool> flooding{true};
+    for (size_t i = 0; i < PRIORITY_BACKLOG; i++) {
+        pool.addTask([&lowDone]() { spinFor(TASK_US); lowDone.fetch_add(1); }, TaskPriority::Low);
+    }
+    std::atomic<size_t> chains{PRIORITY_THREADS * 2}; // 正在执行的高优先级任务链数
+    std::function<void()> high = [&]() {
+        spinFor(TASK_US);
+        if (flooding.load()) {
+            pool.addTask(high, TaskPriority::High);
+        } else {
+            chains.fetch_sub(1);
+        }
+    };
+    for (size_t i = 0; i < PRIORITY_THREADS * 2; i++) {
+        pool.addTask(high, TaskPriority::High);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(STARVE_MS));
+    size_t done = lowDone.load();
+    flooding.store(false);
+    waitFor(chains);
+    return done;
+}
+
+// 高优先级任务等待已在其他线程执行的高优先级子任务，此时有一个低优先级任务排队，返回等待的时长（ms）。
+// 等待中只执行不低于自身优先级的任务时约为WAIT_CHILD_MS，否则会先执行完低优先级任务
+double runHighWait() {
+    ThreadPool pool(2);
+    return pool.submit([&pool]() {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::atomic<bool> started{false};
+        Future<void> child = pool.submit([&started]() {
+            started.store(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_CHILD_MS));
+        }, TaskPriority::High);
+        while (!started.load()) std::this_thread::yield(); // 子任务已被另一个线程取走
+        pool.addTask([]() { std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_LOW_MS)); }, TaskPriority::Low);
+        child.get();
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }, TaskPriority::High).get();
+}
+
+int main() {
+    std::cout << "任务吞吐量（千任务/秒），" << std::thread::hardware_concurrency() << "个CPU；"
+              << "外部：主线程添加" << EMPTY_TASKS << "个空任务；派生：由一个任务添加；分叉-合并：深度" << FORK_DEPTH << "的二叉树" << std::endl;
+    // 表头中每个汉字占3字节、显示为2列，setw按字节计算，所以加上汉字数
+    std::cout << std::setw(8) << "线程" << std::setw(18) << "外部/队列" << std::setw(18) << "外部/窃取" << std::setw(18) << "派生/队列"
+              << std::setw(18) << "派生/窃取" << std::setw(20) << "分叉合并/队列" << std::setw(20) << "分叉合并/窃取" << std::endl;
+    for (size_t threads : THREAD_COUNTS) {
+        double results[] = {
+            runEmptyTasks<QueuePool>(threads, false), runEmptyTasks<ThreadPool>(threads, false),
+            runEmptyTasks<QueuePool>(threads, true), runEmptyTasks<ThreadPool>(threads, true),
+            runForkJoin<QueuePool>(threads), runForkJoin<ThreadPool>(threads)
+        };
+        std::cout << std::setw(6) << threads << std::fixed << std::setprecision(1);
+        for (double result : results) {
+            std::cout << std::setw(14) << result / 1000;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << IDLE_THREADS << "个线程空闲时占用的CPU核数，以及每隔1ms添加一个任务时从添加到开始执行的延迟（" << WAKE_SAMPLES << "次）：" << std::endl;
+    std::cout << std::setw(8) << "线程池" << std::setw(12) << "CPU核数" << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)" << std::endl;
+    const char* names[] = {"队列", "窃取"};
+    double idle[] = {runIdle<QueuePool>(), runIdle<ThreadPool>()};
+    std::vector<double> latencies[] = {runWakeLatency<QueuePool>(), runWakeLatency<ThreadPool>()};
+    for (int i = 0; i < 2; i++) {
+        std::cout << std::setw(8) << names[i] << std::fixed << std::setprecision(2) << std::setw(9) << idle[i] << std::setprecision(1)
+                  << std::setw(10) << latencies[i][latencies[i].size() / 2] << std::setw(10) << latencies[i][latencies[i].size() * 99 / 100] << std::endl;
+    }
+
+    std::cout << ALLOC_THREADS << "个线程，每个任务的内存分配次数和耗时（ns）；小捕获/大捕获：" << ALLOC_BATCHES << "批、每批" << ALLOC_BATCH
+              << "个任务，捕获8/40字节；分叉-合并：深度" << FORK_DEPTH << "的二叉树" << std::endl;
+    std::cout << std::setw(14) << "场景" << std::setw(20) << "分配次数/队列" << std::setw(20) << "分配次数/窃取"
+              << std::setw(14) << "ns/队列" << std::setw(14) << "ns/窃取" << std::endl;
+    const char* scenes[] = {"小捕获", "大捕获", "分叉合并"};
+    AllocResult allocResults[][2] = {
+        {runAllocBatches<QueuePool, 0>(), runAllocBatches<ThreadPool, 0>()},
+        {runAllocBatches<QueuePool, 32>(), runAllocBatches<ThreadPool, 32>()},
+        {runAllocForkJoin<QueuePool>(), runAllocForkJoin<ThreadPool>()}
+    };
+    for (int i = 0; i < 3; i++) {
+        std::cout << std::setw(12 + std::string(scenes[i]).size() / 3) << scenes[i] << std::fixed << std::setprecision(3)
+                  << std::setw(14) << allocResults[i][0].allocsPerTask << std::setw(14) << allocResults[i][1].allocsPerTask
+                  << std::setprecision(1) << std::setw(12) << allocResults[i][0].nsPerTask << std::setw(12) << allocResults[i][1].nsPerTask << std::endl;
+    }
+
+    std::cout << PRIORITY_THREADS << "个线程，先排队" << PRIORITY_BACKLOG << "个" << TASK_US << "us的后台任务，再每隔100us添加一个探测任务，"
+              << "探测任务从添加到开始执行的延迟（" << PROBE_COUNT << "次）：" << std::endl;
+    std::cout << std::setw(28) << "后台/探测优先级" << std::setw(12) << "p50(us)" << std::setw(12) << "p99(us)" << std::endl;
+    const char* probeNames[] = {"普通/普通", "低/高"};
+    std::vector<double> probes[] = {
+        runPriorityLatency(TaskPriority::Normal, TaskPriority::Normal),
+        runPriorityLatency(TaskPriority::Low, TaskPriority::High)
+    };
+    for (int i = 0; i < 2; i++) {
+        std::cout << std::setw(16 + std::string(probeNames[i]).size() / 3) << probeNames[i] << std::fixed << std::setprecision(1)
+                  << std::setw(12) << probes[i][probes[i].size() / 2] << std::setw(12) << probes[i][probes[i].size() * 99 / 100] << std::endl;
+    }
+    std::cout << "高优先级任务占满线程池" << STARVE_MS << "ms期间执行完的低优先级任务数：" << runStarvation()
+              << "（每取" << ThreadPool::LOW_POLL_PERIOD << "次任务有一次先找低优先级）" << std::endl;
+    std::cout << "高优先级任务等待" << WAIT_CHILD_MS << "ms的子任务、同时有" << WAIT_LOW_MS << "ms的低优先级任务排队时的等待时长："
+              << std::fixed << std::setprecision(1) << runHighWait() << "ms" << std::endl;
+    return 0;
+}
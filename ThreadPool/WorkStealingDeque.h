@@ -0,0 +1,98 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Chase-Lev工作窃取双端队列（按Lê等人的C11内存模型版本实现），元素为指针。
+// 只有所属线程调用push()/pop()，在底部进出（后进先出）；其他线程调用steal()从顶部取走最早的元素。
+// 数组满时由所属线程扩容，旧数组保留到析构，窃取者可能仍在读取它。
+template <typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity = 1024) { // capacity向上取整为2的幂
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        arrays.emplace_back(new Array(size));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void push(T* item) { // 所属线程：压入底部
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->mask)) {
+            a = grow(a, t, b);
+        }
+        a->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    T* pop() { // 所属线程：从底部弹出，为空时返回nullptr
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) { // 已空
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = a->get(b);
+        if (t == b) { // 最后一个元素，与窃取者竞争
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T* steal() { // 任意线程：从顶部取走一个元素，为空或与其他线程竞争失败时返回nullptr
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        Array* a = array.load(std::memory_order_acquire);
+        T* item = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool empty() const { // 近似值，只用于判断是否值得窃取
+        return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        explicit Array(size_t size) : mask(size - 1), items(new std::atomic<T*>[size]) {}
+        T* get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T* item) { items[i & mask].store(item, std::memory_order_relaxed); }
+        size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Array* grow(Array* old, int64_t t, int64_t b) { // 容量翻倍，复制[t, b)
+        arrays.emplace_back(new Array((old->mask + 1) * 2));
+        Array* a = arrays.back().get();
+        for (int64_t i = t; i < b; i++) {
+            a->put(i, old->get(i));
+        }
+        array.store(a, std::memory_order_release);
+        return a;
+    }
+
+    alignas(64) std::atomic<int64_t> top{0}; // 窃取端
+    alignas(64) std::atomic<int64_t> bottom{0}; // 所属线程端
+    std::atomic<Array*> array{nullptr};
+    std::vector<std::unique_ptr<Array>> arrays; // 所有用过的数组，只由所属线程修改
+};
+
+#endif // WORKSTEALINGDEQUE_H